@@ -0,0 +1,326 @@
+// hash_set_bench.cpp
+// ------------------
+// Benchmark the open addressing hash sets against std::unordered_set. Each table is sized to a fixed
+// capacity, from one that fits in L1 to one that only fits in DRAM, and filled to a target load factor
+// with either sequential keys, as order ids are, or random keys. Then insert, hit and miss lookups,
+// batched miss lookups where a set has containsBatch, a churn of one insert and one erase that keeps the
+// size steady, and finally erasing every key are timed. Results are written as CSV, in nanoseconds per
+// operation.
+//
+// Usage: hash_set_bench [--capacity N] [--ops N] [--budget-ms N]
+// Without --capacity every default table size is run. A timed phase that runs over the budget stops
+// early and reports the time per operation it managed, which mostly happens when the identity hash
+// meets sequential keys. The sets default to FibonacciHash for integer keys, the _identity rows plug in
+// std::hash to show what that avoids.
+
+#include <chrono>
+#include <cstdint>
+#include <functional>  // std::hash
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+#include "lib/ConcurrentLinearProbingHashSet.h"
+#include "lib/Hash.h"
+#include "lib/LinearProbingHashSet.h"
+#include "lib/SimdLinearProbingHashSet.h"
+
+namespace
+{
+
+using Key = uint32_t;
+
+struct Config
+{
+    // 4Ki sentinel slots fit in L1, 64Ki in L2, 1Mi in a typical L3 and 16Mi only in DRAM
+    std::vector<size_t> capacities{1 << 12, 1 << 16, 1 << 20, 1 << 24};
+    size_t ops = 5'000'000;
+    // Wall clock limit for each timed phase
+    std::chrono::milliseconds budget{2000};
+};
+
+enum class Distribution
+{
+    Sequential,
+    Random
+};
+
+const char* toString(const Distribution distribution)
+{
+    return distribution == Distribution::Sequential ? "sequential" : "random";
+}
+
+struct Keys
+{
+    // The first count keys fill the table, the churn inserts the rest in order while erasing from the
+    // front, so the keys in the table are always a window of count consecutive entries
+    std::vector<Key> sequence;
+    std::vector<Key> absent;
+    size_t count;
+};
+
+// Present and absent keys never overlap and zero is never used, so it is free to mark empty slots
+Keys makeKeys(const Distribution distribution, const size_t count, const size_t ops)
+{
+    Keys keys;
+    keys.count = count;
+    keys.sequence.reserve(count + ops);
+    keys.absent.reserve(ops);
+    if (distribution == Distribution::Sequential)
+    {
+        for (size_t i = 0; i < count + ops; ++i)
+        {
+            keys.sequence.push_back(static_cast<Key>(i + 1));
+        }
+        for (size_t i = 0; i < ops; ++i)
+        {
+            keys.absent.push_back(static_cast<Key>(0x80000000u + i));
+        }
+    }
+    else
+    {
+        // Present keys are odd and absent keys even. Repeats among the random present keys are rare
+        // and just make the odd insert or erase a no-op.
+        std::mt19937_64 rng(42);
+        std::uniform_int_distribution<Key> dist;
+        for (size_t i = 0; i < count + ops; ++i)
+        {
+            keys.sequence.push_back(dist(rng) | 1);
+        }
+        for (size_t i = 0; i < ops; ++i)
+        {
+            keys.absent.push_back((dist(rng) & ~Key{1}) | 2);
+        }
+    }
+    return keys;
+}
+
+// Keeps the compiler from dropping lookups whose result is unused
+volatile size_t sink;
+
+template <typename Set>
+bool contains(const Set& set, const Key key)
+{
+    if constexpr (std::is_same_v<Set, std::unordered_set<Key>>)
+    {
+        return set.count(key) != 0;
+    }
+    else
+    {
+        return set.contains(key);
+    }
+}
+
+template <typename Set>
+bool insert(Set& set, const Key key)
+{
+    if constexpr (std::is_same_v<Set, std::unordered_set<Key>>)
+    {
+        return set.insert(key).second;
+    }
+    else
+    {
+        return set.insert(key);
+    }
+}
+
+template <typename Set>
+bool remove(Set& set, const Key key)
+{
+    if constexpr (std::is_same_v<Set, std::unordered_set<Key>>)
+    {
+        return set.erase(key) != 0;
+    }
+    else
+    {
+        return set.remove(key);
+    }
+}
+
+template <typename Set, typename = void>
+struct HasContainsBatch : std::false_type
+{};
+
+template <typename Set>
+struct HasContainsBatch<
+    Set,
+    std::void_t<decltype(std::declval<const Set&>().containsBatch(nullptr, size_t{}, static_cast<bool*>(nullptr)))>>
+    : std::true_type
+{};
+
+struct Timing
+{
+    double nsPerOp;
+    size_t completed;
+};
+
+// Runs op(i) for i in [0, ops) and stops early once the budget is spent, so that a pathological
+// combination of hash, key distribution and load factor cannot stall the whole run. The clock is only
+// read every 64 ops to keep it out of the measurement.
+template <typename F>
+Timing timeOps(const Config& config, const size_t ops, F&& op)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + config.budget;
+    size_t found = 0;
+    size_t i = 0;
+    for (; i < ops; ++i)
+    {
+        if (i % 64 == 0 && i != 0 && std::chrono::steady_clock::now() > deadline)
+        {
+            break;
+        }
+        found += op(i);
+    }
+    const auto stop = std::chrono::steady_clock::now();
+    sink = found;
+    return {i == 0 ? 0.0 : std::chrono::duration<double, std::nano>(stop - start).count() / i, i};
+}
+
+template <typename Set>
+void run(const Config& config,
+         const std::string& name,
+         Set& set,
+         const size_t capacity,
+         const Distribution distribution,
+         const double loadFactor,
+         const Keys& keys)
+{
+    const Key* present = keys.sequence.data();
+    // The fill is never cut short, every later phase relies on all keys being in
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < keys.count; ++i)
+    {
+        insert(set, present[i]);
+    }
+    const auto stop = std::chrono::steady_clock::now();
+    const double insertNs = std::chrono::duration<double, std::nano>(stop - start).count() / keys.count;
+
+    const Timing hit =
+        timeOps(config, config.ops, [&](const size_t i) { return contains(set, present[i % keys.count]); });
+    const Timing miss = timeOps(config, config.ops, [&](const size_t i) { return contains(set, keys.absent[i]); });
+    std::cout << name << ',' << toString(distribution) << ',' << capacity << ',' << loadFactor << ',' << insertNs
+              << ',' << hit.nsPerOp << ',' << miss.nsPerOp << ',';
+    if constexpr (HasContainsBatch<Set>::value)
+    {
+        constexpr size_t chunk = 64;
+        bool out[chunk];
+        const Timing batchMiss = timeOps(config,
+                                         config.ops / chunk,
+                                         [&](const size_t i)
+                                         {
+                                             set.containsBatch(&keys.absent[i * chunk], chunk, out);
+                                             return out[0];
+                                         });
+        std::cout << batchMiss.nsPerOp / chunk;
+    }
+
+    // Each step inserts the next key of the sequence and erases the oldest one still in the table
+    const Timing churn = timeOps(config,
+                                 config.ops,
+                                 [&](const size_t i)
+                                 {
+                                     insert(set, present[keys.count + i]);
+                                     return remove(set, present[i]);
+                                 });
+    const Timing erase = timeOps(config,
+                                 keys.count,
+                                 [&](const size_t i) { return remove(set, present[churn.completed + i]); });
+    std::cout << ',' << churn.nsPerOp << ',' << erase.nsPerOp << std::endl;
+}
+
+void runAll(const Config& config, const size_t capacity, const Distribution distribution, const double loadFactor)
+{
+    const Keys keys = makeKeys(distribution, static_cast<size_t>(capacity * loadFactor), config.ops);
+    // A max load factor just under one keeps the tables from growing during the fill
+    constexpr float maxLoadFactor = 0.99f;
+    {
+        LinearProbingHashSet<Key> set(capacity, maxLoadFactor);
+        run(config, "linear_probing", set, capacity, distribution, loadFactor, keys);
+    }
+    {
+        LinearProbingHashSet<Key, SentinelSlot<Key, 0>> set(capacity, maxLoadFactor);
+        run(config, "linear_probing_sentinel", set, capacity, distribution, loadFactor, keys);
+    }
+    {
+        LinearProbingHashSet<Key, SentinelSlot<Key, 0>, false, std::hash<Key>> set(capacity, maxLoadFactor);
+        run(config, "linear_probing_sentinel_identity", set, capacity, distribution, loadFactor, keys);
+    }
+    {
+        LinearProbingHashSet<Key, SentinelSlot<Key, 0>, true> set(capacity, maxLoadFactor);
+        run(config, "robin_hood_sentinel", set, capacity, distribution, loadFactor, keys);
+    }
+    {
+        LinearProbingHashSet<Key, SentinelSlot<Key, 0>, true, std::hash<Key>> set(capacity, maxLoadFactor);
+        run(config, "robin_hood_sentinel_identity", set, capacity, distribution, loadFactor, keys);
+    }
+    {
+        SimdLinearProbingHashSet<Key> set(capacity, maxLoadFactor);
+        run(config, "simd_linear_probing", set, capacity, distribution, loadFactor, keys);
+    }
+    {
+        // Single threaded, this is the cost of the atomic slots and the seqlock on their own
+        ConcurrentLinearProbingHashSet<Key, 0> set(capacity, maxLoadFactor);
+        run(config, "concurrent_linear_probing", set, capacity, distribution, loadFactor, keys);
+    }
+    {
+        std::unordered_set<Key> set;
+        set.max_load_factor(1.0f);
+        set.reserve(capacity);
+        run(config, "unordered_set", set, capacity, distribution, loadFactor, keys);
+    }
+}
+
+Config parseArgs(const int argc, char** argv)
+{
+    Config config;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (i + 1 == argc)
+        {
+            throw std::runtime_error("Missing value for " + arg);
+        }
+        const char* value = argv[++i];
+        if (arg == "--capacity")
+        {
+            config.capacities = {std::stoull(value)};
+        }
+        else if (arg == "--ops")
+        {
+            config.ops = std::stoull(value);
+        }
+        else if (arg == "--budget-ms")
+        {
+            config.budget = std::chrono::milliseconds(std::stoll(value));
+        }
+        else
+        {
+            throw std::runtime_error("Unknown argument, " + arg);
+        }
+    }
+    return config;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const Config config = parseArgs(argc, argv);
+    std::cout << "set,distribution,capacity,load_factor,insert_ns,hit_ns,miss_ns,batch_miss_ns,churn_ns,erase_ns"
+              << std::endl;
+    for (const size_t capacity : config.capacities)
+    {
+        for (const Distribution distribution : {Distribution::Sequential, Distribution::Random})
+        {
+            for (const double loadFactor : {0.25, 0.5, 0.75, 0.875, 0.95})
+            {
+                runAll(config, capacity, distribution, loadFactor);
+            }
+        }
+    }
+}
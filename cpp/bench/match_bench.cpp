@@ -0,0 +1,142 @@
+// match_bench.cpp
+// ---------------
+// Benchmark an aggressive order sweeping a deep VectorPriceLevel. For each queue depth the incoming
+// order takes every resting order but the last. The cutoff search is timed with the scalar loop and
+// with matchCutoff, which is the AVX2 kernel on any CPU that supports it. Then the whole
+// VectorPriceLevel::match is timed, including writing fills and erasing the swept orders, and the same
+// sweep of a ChunkedPriceLevel. The levels are copied or rebuilt before each match, and the time of
+// that alone is subtracted. Results are written as CSV, in nanoseconds per sweep.
+//
+// Usage: match_bench [--iterations N]
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "lib/ChunkedPriceLevel.h"
+#include "lib/MatchKernel.h"
+#include "lib/VectorPriceLevel.h"
+
+namespace
+{
+
+// Keeps the optimiser from dropping a result
+template <typename T>
+void doNotOptimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <typename F>
+double timeNs(const size_t iterations, F&& f)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        f();
+    }
+    const auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count() / iterations;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    size_t iterations = 20'000;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc)
+        {
+            iterations = std::stoull(argv[++i]);
+        }
+        else
+        {
+            throw std::runtime_error("Unknown argument, " + arg);
+        }
+    }
+
+#ifdef MATCH_KERNEL_AVX2
+    if (hasAvx2())
+    {
+        std::cerr << "matchCutoff is the AVX2 kernel" << std::endl;
+    }
+    else
+#endif
+    {
+        std::cerr << "matchCutoff is the scalar loop, the CPU has no AVX2" << std::endl;
+    }
+
+    std::mt19937 rng(42);
+    std::cout << "depth,swept,scalar_cutoff_ns,cutoff_ns,match_ns,chunked_match_ns" << std::endl;
+    for (const size_t depth : {8, 32, 128, 512, 2048})
+    {
+        // Sizes from 1 to 30 keep the sweep of the deepest level within one SizeT
+        VectorPriceLevel level(100);
+        std::vector<SizeT> sizes;
+        // At most 2047 orders of up to 30, which always fits a SizeT
+        SizeT quantity = 0;
+        for (size_t i = 0; i < depth; ++i)
+        {
+            const SizeT size = static_cast<SizeT>(rng() % 30 + 1);
+            level.add(Order{static_cast<OrderIdT>(i + 1), size, Side::ASK, 100});
+            sizes.push_back(size);
+            if (i + 1 < depth)
+            {
+                quantity = static_cast<SizeT>(quantity + size);
+            }
+        }
+
+        const double scalar =
+            timeNs(iterations, [&] { doNotOptimize(matchCutoffScalar(sizes.data(), depth, quantity)); });
+        const double kernel = timeNs(iterations, [&] { doNotOptimize(matchCutoff(sizes.data(), depth, quantity)); });
+
+        std::vector<Fill> fills;
+        fills.reserve(depth);
+        const double copy = timeNs(iterations,
+                                   [&]
+                                   {
+                                       VectorPriceLevel copy(level);
+                                       doNotOptimize(copy.size());
+                                   });
+        const double match = timeNs(iterations,
+                                    [&]
+                                    {
+                                        VectorPriceLevel copy(level);
+                                        Order order{0, quantity, Side::BID, 100};
+                                        fills.clear();
+                                        copy.match(order, fills);
+                                        doNotOptimize(copy.size());
+                                    });
+
+        // The chunked level is rebuilt from its pool for each match instead of copied
+        ChunkedPriceLevel::Pool pool;
+        const auto build = [&]
+        {
+            ChunkedPriceLevel chunked(100, pool);
+            for (size_t i = 0; i < depth; ++i)
+            {
+                chunked.add(Order{static_cast<OrderIdT>(i + 1), sizes[i], Side::ASK, 100});
+            }
+            return chunked;
+        };
+        const double rebuild = timeNs(iterations, [&] { doNotOptimize(build().size()); });
+        const double chunkedMatch = timeNs(iterations,
+                                           [&]
+                                           {
+                                               ChunkedPriceLevel chunked = build();
+                                               Order order{0, quantity, Side::BID, 100};
+                                               fills.clear();
+                                               chunked.match(order, fills);
+                                               doNotOptimize(chunked.size());
+                                           });
+
+        std::cout << depth << "," << depth - 1 << "," << scalar << "," << kernel << "," << match - copy << ","
+                  << chunkedMatch - rebuild << std::endl;
+    }
+}
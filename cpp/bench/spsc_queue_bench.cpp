@@ -0,0 +1,356 @@
+// spsc_queue_bench.cpp
+// --------------------
+// Benchmark SPSCQueue throughput and round trip latency against a mutex and deque baseline. The
+// producer and consumer threads are pinned to the given cores and results are written as CSV.
+//
+// Usage: spsc_queue_bench [--producer-cpu N] [--consumer-cpu N] [--messages N] [--round-trips N]
+// A negative cpu leaves the thread unpinned, as does a cpu this process may not run on, with a warning.
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lib/SPSCQueue.h"
+
+namespace
+{
+
+struct Config
+{
+    int producerCpu = 0;
+    int consumerCpu = 1;
+    uint64_t messages = 10'000'000;
+    uint64_t roundTrips = 1'000'000;
+};
+
+template <size_t N>
+struct Payload
+{
+    static_assert(N >= sizeof(uint64_t));
+    uint64_t sequence;
+    std::array<char, N - sizeof(uint64_t)> data;
+
+    Payload() = default;
+
+    explicit Payload(const uint64_t sequence) : sequence(sequence) {}
+};
+
+// Baseline queue with the same interface as SPSCQueue
+template <typename T>
+class MutexQueue
+{
+    std::mutex _mutex;
+    std::deque<T> _items;
+    size_t _capacity;
+
+public:
+    explicit MutexQueue(const size_t capacity) : _capacity(capacity) {}
+
+    bool try_push(const T& v)
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        if (_items.size() == _capacity)
+        {
+            return false;
+        }
+        _items.push_back(v);
+        return true;
+    }
+
+    T* front()
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        return _items.empty() ? nullptr : &_items.front();
+    }
+
+    void pop()
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _items.pop_front();
+    }
+};
+
+// The cpu to pin a thread to, or -1 to leave it unpinned when this process may not run on cpu
+int availableCpu(const std::string& name, const int cpu)
+{
+    if (cpu < 0)
+    {
+        return cpu;
+    }
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &cpuset) != 0 || cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &cpuset))
+    {
+        std::cerr << "Warning: cpu " << cpu << " is not available, running the " << name << " unpinned"
+                  << std::endl;
+        return -1;
+    }
+    return cpu;
+}
+
+void pinThread(const int cpu)
+{
+    if (cpu < 0)
+    {
+        return;
+    }
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    if (const int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset); rc != 0)
+    {
+        std::cerr << "Warning: failed to pin thread to cpu " << cpu << ", " << std::strerror(rc)
+                  << ", running unpinned" << std::endl;
+    }
+}
+
+// Runs f on its own thread. If f throws, failed is set so the other side stops waiting on the queues,
+// and join() rethrows the exception.
+class BenchThread
+{
+    std::atomic<bool>& _failed;
+    std::exception_ptr _error;
+    std::thread _thread;
+
+public:
+    template <typename F>
+    BenchThread(std::atomic<bool>& failed, F f)
+        : _failed(failed),
+          _thread(
+              [this, f = std::move(f)]
+              {
+                  try
+                  {
+                      f();
+                  }
+                  catch (...)
+                  {
+                      _error = std::current_exception();
+                      _failed.store(true, std::memory_order_release);
+                  }
+              })
+    {}
+
+    void join()
+    {
+        _thread.join();
+        if (_error)
+        {
+            std::rethrow_exception(_error);
+        }
+    }
+};
+
+// Spin until v is pushed, returning false if the other side failed. The flag is only checked while
+// the queue is full, so the fast path is unchanged.
+template <typename Queue, typename T>
+bool push(Queue& q, const T& v, const std::atomic<bool>& failed)
+{
+    while (!q.try_push(v))
+    {
+        if (failed.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Spin until there is a front element, returning nullptr if the other side failed
+template <typename Queue>
+auto* pop(Queue& q, const std::atomic<bool>& failed)
+{
+    decltype(q.front()) v;
+    while (!(v = q.front()))
+    {
+        if (failed.load(std::memory_order_acquire))
+        {
+            return v;
+        }
+    }
+    return v;
+}
+
+template <typename Queue, typename T>
+double throughput(const Config& config, const size_t capacity)
+{
+    auto q = std::make_unique<Queue>(capacity);
+    std::atomic<bool> failed{false};
+    BenchThread consumer(
+        failed,
+        [&]
+        {
+            pinThread(config.consumerCpu);
+            for (uint64_t i = 0; i < config.messages; ++i)
+            {
+                T* v = pop(*q, failed);
+                if (!v)
+                {
+                    return;
+                }
+                if (v->sequence != i)
+                {
+                    throw std::logic_error("Out of order sequence");
+                }
+                q->pop();
+            }
+        });
+
+    pinThread(config.producerCpu);
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < config.messages && push(*q, T{i}, failed); ++i)
+    {
+    }
+    consumer.join();
+    const auto stop = std::chrono::steady_clock::now();
+    return config.messages / std::chrono::duration<double>(stop - start).count();
+}
+
+template <typename Queue, typename T>
+std::vector<int64_t> roundTrip(const Config& config, const size_t capacity)
+{
+    auto ping = std::make_unique<Queue>(capacity);
+    auto pong = std::make_unique<Queue>(capacity);
+    std::atomic<bool> failed{false};
+    BenchThread echo(
+        failed,
+        [&]
+        {
+            pinThread(config.consumerCpu);
+            for (uint64_t i = 0; i < config.roundTrips; ++i)
+            {
+                T* v = pop(*ping, failed);
+                if (!v || !push(*pong, *v, failed))
+                {
+                    return;
+                }
+                ping->pop();
+            }
+        });
+
+    pinThread(config.producerCpu);
+    std::vector<int64_t> latencies;
+    latencies.reserve(config.roundTrips);
+    for (uint64_t i = 0; i < config.roundTrips; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        if (!push(*ping, T{i}, failed) || !pop(*pong, failed))
+        {
+            break;
+        }
+        pong->pop();
+        const auto stop = std::chrono::steady_clock::now();
+        latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+    }
+    echo.join();
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+int64_t percentile(const std::vector<int64_t>& sorted, const double p)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+template <typename Queue, typename T>
+void run(const Config& config, const std::string& name, const size_t capacity)
+{
+    const double rate = throughput<Queue, T>(config, capacity);
+    std::cout << "throughput," << name << ',' << sizeof(T) << ',' << capacity << ',' << static_cast<uint64_t>(rate)
+              << ",,,,," << std::endl;
+
+    const auto latencies = roundTrip<Queue, T>(config, capacity);
+    std::cout << "round_trip," << name << ',' << sizeof(T) << ',' << capacity << ",," << percentile(latencies, 0.5)
+              << ',' << percentile(latencies, 0.9) << ',' << percentile(latencies, 0.99) << ','
+              << percentile(latencies, 0.999) << ',' << (latencies.empty() ? 0 : latencies.back()) << std::endl;
+}
+
+template <typename T>
+void runAll(const Config& config)
+{
+    for (const size_t capacity : {64, 1024, 65536})
+    {
+        run<SPSCQueue<T>, T>(config, "spsc", capacity);
+        run<SPSCQueue<T, std::allocator<T>, true>, T>(config, "spsc_pow2", capacity);
+        run<MutexQueue<T>, T>(config, "mutex_deque", capacity);
+    }
+}
+
+Config parseArgs(const int argc, char** argv)
+{
+    Config config;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (i + 1 == argc)
+        {
+            throw std::runtime_error("Missing value for " + arg);
+        }
+        const char* value = argv[++i];
+        if (arg == "--producer-cpu")
+        {
+            config.producerCpu = std::stoi(value);
+        }
+        else if (arg == "--consumer-cpu")
+        {
+            config.consumerCpu = std::stoi(value);
+        }
+        else if (arg == "--messages")
+        {
+            config.messages = std::stoull(value);
+        }
+        else if (arg == "--round-trips")
+        {
+            config.roundTrips = std::stoull(value);
+        }
+        else
+        {
+            throw std::runtime_error("Unknown argument, " + arg);
+        }
+    }
+    return config;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        Config config = parseArgs(argc, argv);
+        config.producerCpu = availableCpu("producer", config.producerCpu);
+        config.consumerCpu = availableCpu("consumer", config.consumerCpu);
+        std::cerr << "producer cpu " << config.producerCpu << ", consumer cpu " << config.consumerCpu << std::endl;
+        // Throughput is in messages per second, latencies are round trip nanoseconds
+        std::cout << "benchmark,queue,payload_bytes,capacity,msgs_per_sec,p50_ns,p90_ns,p99_ns,p999_ns,max_ns"
+                  << std::endl;
+        runAll<Payload<16>>(config);
+        runAll<Payload<64>>(config);
+        runAll<Payload<256>>(config);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
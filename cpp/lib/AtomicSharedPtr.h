@@ -0,0 +1,89 @@
+#pragma once
+
+// AtomicSharedPtr.h
+// -----------------
+// Holds a SharedPtr that one writer replaces and any number of readers copy concurrently, in the style
+// of read-copy-update. The writer builds a new immutable object and publishes it with store(). A
+// reader calls load() to take its own reference to the current object, which stays valid however
+// many stores happen after, and the object is deleted when its last reference goes away.
+//
+// The current SharedPtr lives in a holder the readers copy from. load() is wait free: it registers
+// on the reader counter for the parity of the current epoch, copies the holder, and leaves. store()
+// swaps in a new holder, then for each parity in turn flips the epoch so new readers count on the
+// other one and waits for the counter to drain, before it drops the old holder's reference. Any reader
+// that saw the old holder registered before the swap, so it has left by then. The wait is only as long
+// as an in flight load(), and the old holder is recycled for the next store so steady state publishing
+// does not allocate.
+
+#include <atomic>
+#include <cstdint>
+#include <new>  // std::hardware_destructive_interference_size
+#include <thread>
+#include <utility>
+
+#include "lib/SharedPtr.h"
+
+template <typename T>
+class AtomicSharedPtr
+{
+#ifdef __cpp_lib_hardware_interference_size
+    static constexpr size_t _cacheLineSize = std::hardware_destructive_interference_size;
+#else
+    static constexpr size_t _cacheLineSize = 64;
+#endif
+
+public:
+    using Ptr = SharedPtr<T, AtomicRefCount>;
+
+private:
+    std::atomic<Ptr*> _current;
+    std::atomic<uint64_t> _epoch{0};
+    // Readers currently inside load(), indexed by the parity of the epoch they started in
+    alignas(_cacheLineSize) mutable std::atomic<uint64_t> _readers[2]{};
+
+    // Only touched by the writer
+    alignas(_cacheLineSize) Ptr* _spare = nullptr;
+
+public:
+    explicit AtomicSharedPtr(Ptr ptr = Ptr()) : _current(new Ptr(std::move(ptr))) {}
+
+    ~AtomicSharedPtr()
+    {
+        delete _current.load(std::memory_order_relaxed);
+        delete _spare;
+    }
+
+    AtomicSharedPtr(const AtomicSharedPtr&) = delete;
+    AtomicSharedPtr& operator=(const AtomicSharedPtr&) = delete;
+
+    // Safe to call from any number of threads concurrently with store()
+    Ptr load() const
+    {
+        std::atomic<uint64_t>& readers = _readers[_epoch.load() & 1];
+        readers.fetch_add(1);
+        Ptr result{*_current.load()};
+        readers.fetch_sub(1, std::memory_order_release);
+        return result;
+    }
+
+    // Only one thread at a time may store
+    void store(Ptr ptr)
+    {
+        Ptr* holder = _spare ? _spare : new Ptr();
+        *holder = std::move(ptr);
+        Ptr* const old = _current.exchange(holder);
+
+        uint64_t epoch = _epoch.load(std::memory_order_relaxed);
+        for (int parity = 0; parity < 2; ++parity, ++epoch)
+        {
+            _epoch.store(epoch + 1);
+            while (_readers[epoch & 1].load() != 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        *old = Ptr();
+        _spare = old;
+    }
+};
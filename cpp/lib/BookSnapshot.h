@@ -0,0 +1,33 @@
+#pragma once
+
+// BookSnapshot.h
+// --------------
+// Immutable top of book view for readers outside the matching thread. The order books fill one with
+// snapshot(depth) and the matching thread publishes it through an AtomicSharedPtr, so risk and UI
+// threads read a consistent copy without touching the live book.
+
+#include <cstdint>
+#include <vector>
+
+#include "lib/types.h"
+
+struct DepthLevel
+{
+    PriceT price;
+    // Total resting size and number of orders at the price
+    uint64_t size;
+    uint32_t orders;
+};
+
+struct BookSnapshot
+{
+    // Set by the publisher, e.g. the number of events applied to the book when it was taken
+    uint64_t sequence = 0;
+    // Best price first on both sides
+    std::vector<DepthLevel> bids;
+    std::vector<DepthLevel> asks;
+
+    const DepthLevel* bestBid() const { return bids.empty() ? nullptr : &bids.front(); }
+
+    const DepthLevel* bestAsk() const { return asks.empty() ? nullptr : &asks.front(); }
+};
@@ -0,0 +1,285 @@
+#pragma once
+
+// ChunkedPriceLevel.h
+// -------------------
+// Price level storing its orders in a doubly linked list of fixed size chunks. Each chunk is cache line
+// aligned and holds the sizes and oids of up to ChunkSize orders as two small arrays, with a bit mask of
+// the slots still resting. Orders are appended at the tail and matched from the head, and an order's
+// position is its chunk and slot, which never moves. That gives O(1) append, pop front and cancel with
+// the contiguity of a vector and the stable positions of a list.
+//
+// A chunk is released as soon as its last order leaves, whether by matching or cancelling. Released
+// chunks go back to an OrderChunkPool shared by every level of a book, which keeps them on a free list
+// for the next level that needs one, so a book in steady state does not allocate. The pool must
+// outlive the levels that use it.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>  // std::allocator, std::allocator_traits
+#include <new>     // std::hardware_destructive_interference_size
+#include <utility>
+#include <vector>
+
+#include "lib/Fill.h"
+#include "lib/Order.h"
+
+template <size_t ChunkSize = 16, typename Allocator = std::allocator<Order>>
+class OrderChunkPool
+{
+    static_assert(ChunkSize > 0 && ChunkSize <= 32, "A chunk tracks its slots in a 32 bit mask");
+
+#ifdef __cpp_lib_hardware_interference_size
+    static constexpr size_t _cacheLineSize = std::hardware_destructive_interference_size;
+#else
+    static constexpr size_t _cacheLineSize = 64;
+#endif
+
+public:
+    struct alignas(_cacheLineSize) Chunk
+    {
+        Chunk* prev;
+        Chunk* next;
+        // Bit per slot holding a resting order
+        uint32_t live;
+        // Slots before end have been used, the next order is appended there
+        uint32_t end;
+        SizeT sizes[ChunkSize];
+        OrderIdT oids[ChunkSize];
+    };
+
+private:
+    using ChunkAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Chunk>;
+
+    ChunkAllocator _allocator;
+    Chunk* _free = nullptr;
+    size_t _allocated = 0;
+    size_t _available = 0;
+
+public:
+    explicit OrderChunkPool(const Allocator& allocator = Allocator()) : _allocator(allocator) {}
+
+    ~OrderChunkPool()
+    {
+        while (_free)
+        {
+            Chunk* const chunk = _free;
+            _free = chunk->next;
+            std::allocator_traits<ChunkAllocator>::deallocate(_allocator, chunk, 1);
+        }
+    }
+
+    OrderChunkPool(const OrderChunkPool&) = delete;
+    OrderChunkPool& operator=(const OrderChunkPool&) = delete;
+
+    // An empty chunk, unlinked
+    Chunk* acquire()
+    {
+        Chunk* chunk = _free;
+        if (chunk)
+        {
+            _free = chunk->next;
+            --_available;
+        }
+        else
+        {
+            chunk = std::allocator_traits<ChunkAllocator>::allocate(_allocator, 1);
+            ++_allocated;
+        }
+        chunk->prev = nullptr;
+        chunk->next = nullptr;
+        chunk->live = 0;
+        chunk->end = 0;
+        return chunk;
+    }
+
+    void release(Chunk* const chunk) noexcept
+    {
+        chunk->next = _free;
+        _free = chunk;
+        ++_available;
+    }
+
+    // Chunks allocated over the pool's lifetime, and how many of them are on the free list
+    size_t allocated() const { return _allocated; }
+
+    size_t available() const { return _available; }
+};
+
+template <size_t ChunkSize = 16, typename Allocator = std::allocator<Order>>
+class BasicChunkedPriceLevel
+{
+public:
+    using Pool = OrderChunkPool<ChunkSize, Allocator>;
+    using Chunk = typename Pool::Chunk;
+    // The levels of a book share one pool
+    using Context = Pool;
+
+    // Where an order rests, valid until it is filled or cancelled
+    struct Position
+    {
+        Chunk* chunk;
+        uint32_t slot;
+    };
+
+private:
+    PriceT _price;
+    Pool* _pool;
+    Chunk* _head = nullptr;
+    Chunk* _tail = nullptr;
+    size_t _size = 0;
+    // Sum of the resting sizes, kept up to date so depth is O(1)
+    uint64_t _totalSize = 0;
+
+    void unlink(Chunk* const chunk) noexcept
+    {
+        (chunk->prev ? chunk->prev->next : _head) = chunk->next;
+        (chunk->next ? chunk->next->prev : _tail) = chunk->prev;
+        _pool->release(chunk);
+    }
+
+    void clear() noexcept
+    {
+        while (_head)
+        {
+            unlink(_head);
+        }
+        _size = 0;
+        _totalSize = 0;
+    }
+
+public:
+    BasicChunkedPriceLevel(const PriceT price, Pool& pool) : _price(price), _pool(&pool) {}
+
+    BasicChunkedPriceLevel(BasicChunkedPriceLevel&& other) noexcept
+        : _price(other._price),
+          _pool(other._pool),
+          _head(other._head),
+          _tail(other._tail),
+          _size(other._size),
+          _totalSize(other._totalSize)
+    {
+        other._head = nullptr;
+        other._tail = nullptr;
+        other._size = 0;
+        other._totalSize = 0;
+    }
+
+    BasicChunkedPriceLevel& operator=(BasicChunkedPriceLevel&& other) noexcept
+    {
+        if (this != &other)
+        {
+            clear();
+            _price = other._price;
+            _pool = other._pool;
+            _head = std::exchange(other._head, nullptr);
+            _tail = std::exchange(other._tail, nullptr);
+            _size = std::exchange(other._size, 0);
+            _totalSize = std::exchange(other._totalSize, 0);
+        }
+        return *this;
+    }
+
+    BasicChunkedPriceLevel(const BasicChunkedPriceLevel&) = delete;
+    BasicChunkedPriceLevel& operator=(const BasicChunkedPriceLevel&) = delete;
+
+    ~BasicChunkedPriceLevel() { clear(); }
+
+    inline PriceT getPrice() const { return _price; }
+
+    Position add(const Order& order)
+    {
+        if (!_tail || _tail->end == ChunkSize)
+        {
+            Chunk* const chunk = _pool->acquire();
+            chunk->prev = _tail;
+            (_tail ? _tail->next : _head) = chunk;
+            _tail = chunk;
+        }
+        const uint32_t slot = _tail->end++;
+        _tail->sizes[slot] = order.size;
+        _tail->oids[slot] = order.oid;
+        _tail->live |= 1u << slot;
+        ++_size;
+        _totalSize += order.size;
+        return {_tail, slot};
+    }
+
+    // Match against the resting orders in time priority, appending a fill per order traded with. Works a
+    // chunk at a time, making room for a fill per resting order of the chunk and then writing them
+    // through a raw pointer, as stores through push_back may alias the chunk and force reloads.
+    void match(Order& order, std::vector<Fill>& fills)
+    {
+        SizeT remaining = order.size;
+        while (remaining > 0 && _head)
+        {
+            Chunk* const chunk = _head;
+            uint32_t live = chunk->live;
+            const size_t first = fills.size();
+            fills.resize(first + static_cast<size_t>(__builtin_popcount(live)));
+            Fill* fill = fills.data() + first;
+            while (remaining > 0 && live != 0)
+            {
+                const uint32_t slot = static_cast<uint32_t>(__builtin_ctz(live));
+                const SizeT size = std::min(remaining, chunk->sizes[slot]);
+                const SizeT resting = chunk->sizes[slot] - size;
+                chunk->sizes[slot] = resting;
+                remaining -= size;
+                fill->price = _price;
+                fill->aggressorOid = order.oid;
+                fill->passiveOid = chunk->oids[slot];
+                fill->size = size;
+                fill->passiveRemaining = resting;
+                fill->passiveFilled = resting == 0;
+                ++fill;
+                if (resting == 0)
+                {
+                    live &= live - 1;
+                    --_size;
+                }
+            }
+            fills.resize(fill - fills.data());
+            chunk->live = live;
+            if (live == 0)
+            {
+                unlink(chunk);
+            }
+        }
+        _totalSize -= order.size - remaining;
+        order.size = remaining;
+    }
+
+    void cancel(const Position position)
+    {
+        Chunk* const chunk = position.chunk;
+        chunk->live &= ~(1u << position.slot);
+        --_size;
+        _totalSize -= chunk->sizes[position.slot];
+        if (chunk->live == 0)
+        {
+            unlink(chunk);
+        }
+    }
+
+    bool empty() const { return _size == 0; }
+
+    size_t size() const { return _size; }
+
+    uint64_t totalSize() const { return _totalSize; }
+
+    // Call f(oid, size) for each resting order in time priority
+    template <typename F>
+    void forEach(F&& f) const
+    {
+        for (const Chunk* chunk = _head; chunk; chunk = chunk->next)
+        {
+            for (uint32_t live = chunk->live; live != 0; live &= live - 1)
+            {
+                const uint32_t slot = static_cast<uint32_t>(__builtin_ctz(live));
+                f(chunk->oids[slot], chunk->sizes[slot]);
+            }
+        }
+    }
+};
+
+using ChunkedPriceLevel = BasicChunkedPriceLevel<>;
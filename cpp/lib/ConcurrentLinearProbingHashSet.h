@@ -0,0 +1,306 @@
+#pragma once
+
+// ConcurrentLinearProbingHashSet.h
+// --------------------------------
+// Concurrent sibling of LinearProbingHashSet for read mostly sets, such as a symbol or order id
+// registry that many threads consult and a single thread mutates. One writer thread calls insert,
+// remove, reserve and reclaim while any number of reader threads call contains without taking a lock.
+//
+// Keys are stored directly in atomic slots, so T must be trivially copyable with lock free atomics, and
+// EmptyKey is reserved to mark an empty slot as with SentinelSlot. Hash defaults to DefaultHash, as for
+// LinearProbingHashSet. An insert fills an empty slot with a single store which a reader either sees or
+// not, so inserts never disturb readers. Removal uses backward shift deletion, which briefly opens a
+// hole in the middle of a probe chain. It is wrapped in a seqlock and a reader that overlaps a removal
+// retries its lookup.
+//
+// Growing builds a complete new table and publishes it with a single pointer store. Readers may still
+// be probing the old table, so it is retired rather than freed, and reclaimed with epochs as in
+// AtomicSharedPtr. contains registers on the reader counter for the parity of the current epoch while
+// it probes. The writer only moves the epoch on once the readers of the previous epoch, which share the
+// parity of the next one, have left, and frees a table two epochs after it was retired, when every
+// reader that could have seen it is gone. reclaim() makes as much progress as it can without waiting
+// and runs after every resize, so the writer never blocks on a reader. A reader stalled mid lookup only
+// delays the freeing, and with doubling growth the retired tables together are never larger than the
+// current one.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>  // std::unique_ptr
+#include <new>     // std::hardware_destructive_interference_size
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "lib/Hash.h"
+
+template <typename T, T EmptyKey, typename Hash = DefaultHash<T>>
+class ConcurrentLinearProbingHashSet
+{
+#ifdef __cpp_lib_hardware_interference_size
+    static constexpr size_t _cacheLineSize = std::hardware_destructive_interference_size;
+#else
+    static constexpr size_t _cacheLineSize = 64;
+#endif
+
+    static constexpr size_t _minCapacity = 8;
+
+    struct Table
+    {
+        size_t mask;
+        std::unique_ptr<std::atomic<T>[]> slots;
+
+        explicit Table(const size_t capacity) : mask(capacity - 1), slots(new std::atomic<T>[capacity])
+        {
+            for (size_t i = 0; i < capacity; ++i)
+            {
+                slots[i].store(EmptyKey, std::memory_order_relaxed);
+            }
+        }
+
+        size_t capacity() const { return mask + 1; }
+    };
+
+    struct RetiredTable
+    {
+        std::unique_ptr<Table> table;
+        // Epoch the table was retired in, it is freed once the epoch is two further on
+        uint64_t epoch;
+    };
+
+    float _maxLoadFactor;
+    Hash _hasher;
+    // Tables replaced by a resize that readers may still be probing, only touched by the writer
+    std::vector<RetiredTable> _retired;
+
+    // Align to cache line size in order to keep the reader hot path away from writer bookkeeping
+    alignas(_cacheLineSize) std::atomic<Table*> _table;
+    // Odd while a removal is moving keys around
+    std::atomic<uint64_t> _sequence{0};
+    std::atomic<uint64_t> _epoch{0};
+    // Readers currently inside contains, indexed by the parity of the epoch they started in
+    alignas(_cacheLineSize) mutable std::atomic<uint64_t> _readers[2]{};
+
+    alignas(_cacheLineSize) std::atomic<size_t> _size{0};
+
+    // Registers a reader on the counter of the current epoch's parity for as long as it lives
+    class ReaderGuard
+    {
+        std::atomic<uint64_t>& _counter;
+
+    public:
+        explicit ReaderGuard(const ConcurrentLinearProbingHashSet& set) : _counter(set._readers[set._epoch.load() & 1])
+        {
+            _counter.fetch_add(1);
+        }
+
+        ~ReaderGuard() { _counter.fetch_sub(1, std::memory_order_release); }
+
+        ReaderGuard(const ReaderGuard&) = delete;
+        ReaderGuard& operator=(const ReaderGuard&) = delete;
+    };
+
+    static size_t roundUpToPowerOfTwo(const size_t n)
+    {
+        size_t result = 1;
+        while (result < n)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    size_t getHash(const Table& table, const T& item) const { return _hasher(item) & table.mask; }
+
+    // Smallest power of two capacity holding count items without going over the max load factor
+    size_t capacityFor(const size_t count) const
+    {
+        const size_t needed = static_cast<size_t>(std::ceil(static_cast<double>(count) / _maxLoadFactor));
+        return roundUpToPowerOfTwo(std::max(needed, _minCapacity));
+    }
+
+    // Index of the item, or of the first empty slot of its probe chain. The load factor guarantees
+    // that an empty slot exists.
+    size_t find(const Table& table, const T& item) const
+    {
+        size_t i = getHash(table, item);
+        while (true)
+        {
+            const T slot = table.slots[i].load(std::memory_order_relaxed);
+            if (slot == EmptyKey || slot == item)
+            {
+                return i;
+            }
+            i = (i + 1) & table.mask;
+        }
+    }
+
+    void rehash(const size_t capacity)
+    {
+        Table* const oldTable = _table.load(std::memory_order_relaxed);
+        auto newTable = std::make_unique<Table>(capacity);
+        for (size_t i = 0; i <= oldTable->mask; ++i)
+        {
+            const T slot = oldTable->slots[i].load(std::memory_order_relaxed);
+            if (slot != EmptyKey)
+            {
+                newTable->slots[find(*newTable, slot)].store(slot, std::memory_order_relaxed);
+            }
+        }
+        // Publishes the filled slots together with the table. Sequentially consistent, so that a reader
+        // registering after the epoch checks in reclaim() cannot load the old table.
+        _table.store(newTable.release());
+        _retired.push_back(RetiredTable{std::unique_ptr<Table>(oldTable), _epoch.load(std::memory_order_relaxed)});
+        reclaim();
+    }
+
+public:
+    // The capacity is rounded up to a power of two
+    explicit ConcurrentLinearProbingHashSet(const size_t capacity = _minCapacity, const float maxLoadFactor = 0.75f)
+        : _maxLoadFactor(maxLoadFactor)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+        static_assert(std::atomic<T>::is_always_lock_free, "T must have lock free atomics");
+        if (!(_maxLoadFactor > 0.0f && _maxLoadFactor < 1.0f))
+        {
+            throw std::invalid_argument("Max load factor must be in (0, 1), " + std::to_string(_maxLoadFactor));
+        }
+        _table.store(new Table(roundUpToPowerOfTwo(std::max(capacity, _minCapacity))), std::memory_order_relaxed);
+    }
+
+    ~ConcurrentLinearProbingHashSet() { delete _table.load(std::memory_order_relaxed); }
+
+    ConcurrentLinearProbingHashSet(const ConcurrentLinearProbingHashSet&) = delete;
+    ConcurrentLinearProbingHashSet& operator=(const ConcurrentLinearProbingHashSet&) = delete;
+
+    // Writer only
+    bool insert(const T& item)
+    {
+        if (item == EmptyKey)
+        {
+            throw std::invalid_argument("Cannot insert the empty key");
+        }
+        Table* table = _table.load(std::memory_order_relaxed);
+        size_t i = find(*table, item);
+        if (table->slots[i].load(std::memory_order_relaxed) == item)
+        {
+            return false;
+        }
+        const size_t size = _size.load(std::memory_order_relaxed);
+        if (static_cast<double>(size + 1) > table->capacity() * static_cast<double>(_maxLoadFactor))
+        {
+            rehash(table->capacity() * 2);
+            table = _table.load(std::memory_order_relaxed);
+            i = find(*table, item);
+        }
+        table->slots[i].store(item, std::memory_order_release);
+        _size.store(size + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Writer only
+    bool remove(const T& item)
+    {
+        Table& table = *_table.load(std::memory_order_relaxed);
+        size_t i = find(table, item);
+        if (table.slots[i].load(std::memory_order_relaxed) != item)
+        {
+            return false;
+        }
+
+        const uint64_t sequence = _sequence.load(std::memory_order_relaxed);
+        _sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        // Backward shift deletion, see LinearProbingHashSet::remove
+        size_t j = i;
+        while (true)
+        {
+            j = (j + 1) & table.mask;
+            const T slot = table.slots[j].load(std::memory_order_relaxed);
+            if (slot == EmptyKey)
+            {
+                break;
+            }
+            const size_t home = getHash(table, slot);
+            if (((j - home) & table.mask) >= ((j - i) & table.mask))
+            {
+                table.slots[i].store(slot, std::memory_order_relaxed);
+                i = j;
+            }
+        }
+        table.slots[i].store(EmptyKey, std::memory_order_relaxed);
+
+        _sequence.store(sequence + 2, std::memory_order_release);
+        _size.store(_size.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Safe to call from any number of threads concurrently with the writer
+    bool contains(const T& item) const
+    {
+        if (item == EmptyKey)
+        {
+            return false;
+        }
+        const ReaderGuard guard(*this);
+        while (true)
+        {
+            const uint64_t before = _sequence.load(std::memory_order_acquire);
+            if (before & 1)
+            {
+                continue;
+            }
+            const Table& table = *_table.load();
+            const bool found = table.slots[find(table, item)].load(std::memory_order_relaxed) == item;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (_sequence.load(std::memory_order_relaxed) == before)
+            {
+                return found;
+            }
+        }
+    }
+
+    size_t size() const { return _size.load(std::memory_order_relaxed); }
+
+    size_t capacity() const
+    {
+        const ReaderGuard guard(*this);
+        return _table.load()->capacity();
+    }
+
+    float loadFactor() const { return static_cast<float>(size()) / capacity(); }
+
+    float maxLoadFactor() const { return _maxLoadFactor; }
+
+    // Writer only, grow so that count items fit without further resizes
+    void reserve(const size_t count)
+    {
+        const size_t capacity = capacityFor(count);
+        if (capacity > _table.load(std::memory_order_relaxed)->capacity())
+        {
+            rehash(capacity);
+        }
+    }
+
+    // Writer only, free the retired tables no reader can still be probing, without waiting for readers.
+    // Called by every resize, so it only needs calling to free the last tables once readers go quiet.
+    void reclaim()
+    {
+        uint64_t epoch = _epoch.load(std::memory_order_relaxed);
+        // Readers of the previous epoch count on the parity the next epoch will use
+        while (!_retired.empty() && _readers[(epoch + 1) & 1].load() == 0)
+        {
+            _epoch.store(++epoch);
+            _retired.erase(std::remove_if(_retired.begin(),
+                                          _retired.end(),
+                                          [&](const RetiredTable& retired) { return retired.epoch + 2 <= epoch; }),
+                           _retired.end());
+        }
+    }
+
+    // Number of retired tables waiting to be freed
+    size_t retired() const { return _retired.size(); }
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+// Fill.h
+// ------
+// One trade between an incoming order and a resting order, as returned by the order books. The
+// passive side's remaining size comes with the fill, and passiveFilled says the resting order left
+// the book, so consumers need not look the order up again. A fill is 24 bytes, half the pair of
+// Order structs the books used to return.
+
+#include <cstdint>
+
+#include "lib/types.h"
+
+struct Fill
+{
+    PriceT price;
+    OrderIdT aggressorOid;
+    OrderIdT passiveOid;
+    SizeT size;
+    // Size of the passive order still resting after the fill
+    SizeT passiveRemaining;
+    bool passiveFilled;
+};
+
+static_assert(sizeof(Fill) <= 24, "Fill should stay within 24 bytes");
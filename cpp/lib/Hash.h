@@ -0,0 +1,102 @@
+#pragma once
+
+// Hash.h
+// ------
+// Fast hash functors for the open addressing sets, which index with the low bits of the hash.
+//
+// FibonacciHash multiplies an integer key by 2^64 / phi and folds the high half of the product into
+// the low half. Consecutive keys such as order ids end up spread across the table instead of sitting
+// in one run of adjacent slots as they do with the identity std::hash. DefaultHash picks it for integer
+// and enum keys and std::hash for everything else, and is what the sets use unless told otherwise.
+//
+// WyHash is a string hash in the style of wyhash, reading eight bytes at a time and mixing with a
+// 64 x 64 -> 128 bit multiply. It is transparent and hashes anything convertible to std::string_view,
+// so it pairs with std::equal_to<> for heterogeneous lookup.
+
+#include <cstdint>
+#include <cstring>
+#include <functional>  // std::hash
+#include <string_view>
+#include <type_traits>
+
+struct FibonacciHash
+{
+    template <typename T>
+    size_t operator()(const T key) const noexcept
+    {
+        static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "FibonacciHash needs an integer key");
+        const uint64_t h = static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(h ^ (h >> 32));
+    }
+};
+
+template <typename T>
+using DefaultHash =
+    std::conditional_t<std::is_integral<T>::value || std::is_enum<T>::value, FibonacciHash, std::hash<T>>;
+
+class WyHash
+{
+    static constexpr uint64_t _secret0 = 0xA0761D6478BD642FULL;
+    static constexpr uint64_t _secret1 = 0xE7037ED1A0B428DBULL;
+
+    uint64_t _seed;
+
+    static uint64_t mix(const uint64_t a, const uint64_t b)
+    {
+        const __uint128_t product = static_cast<__uint128_t>(a) * b;
+        return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+    }
+
+    static uint64_t read64(const char* p)
+    {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    static uint64_t read32(const char* p)
+    {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+public:
+    using is_transparent = void;
+
+    explicit WyHash(const uint64_t seed = 0) : _seed(seed) {}
+
+    size_t operator()(const std::string_view key) const noexcept
+    {
+        const char* p = key.data();
+        size_t length = key.size();
+        uint64_t seed = _seed ^ mix(_seed ^ _secret0, _secret1);
+        while (length > 16)
+        {
+            seed = mix(read64(p) ^ _secret1, read64(p + 8) ^ seed);
+            p += 16;
+            length -= 16;
+        }
+
+        // The last up to 16 bytes, read as two possibly overlapping words
+        uint64_t a = 0;
+        uint64_t b = 0;
+        if (length >= 8)
+        {
+            a = read64(p);
+            b = read64(p + length - 8);
+        }
+        else if (length >= 4)
+        {
+            a = read32(p);
+            b = read32(p + length - 4);
+        }
+        else if (length > 0)
+        {
+            a = (static_cast<uint64_t>(static_cast<unsigned char>(p[0])) << 16)
+                | (static_cast<uint64_t>(static_cast<unsigned char>(p[length >> 1])) << 8)
+                | static_cast<unsigned char>(p[length - 1]);
+        }
+        return static_cast<size_t>(mix(_secret1 ^ key.size(), mix(a ^ _secret1, b ^ seed)));
+    }
+};
@@ -0,0 +1,252 @@
+#pragma once
+
+// HugePageAllocator.h
+// -------------------
+// HugePageArena maps a single region backed by huge pages, optionally bound to a NUMA node and
+// pre-faulted so that no page faults happen on the hot path. It first tries explicit huge pages
+// with MAP_HUGETLB and falls back to regular pages with transparent huge page advice.
+//
+// Allocations are carved out of the region with a bump pointer and recycled through power of two
+// size class free lists, which suits both one large allocation (SPSCQueue slots) and many small node
+// allocations (order book maps and lists). The arena is not thread safe, use one per thread.
+//
+// HugePageAllocator is a standard allocator handing out memory from an arena. The arena must outlive
+// every allocator and container using it.
+
+#include <linux/mempolicy.h>  // MPOL_BIND
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <climits>  // CHAR_BIT
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>  // std::bad_alloc
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class HugePageArena
+{
+    static constexpr size_t _hugePageSize = 2 * 1024 * 1024;
+    static constexpr size_t _minClassShift = 4;
+    static constexpr size_t _numClasses = 64;
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    char* _begin;
+    char* _next;
+    char* _end;
+    size_t _mappedSize;
+    bool _hugeTlb;
+    std::array<FreeBlock*, _numClasses> _freeLists{};
+
+    static size_t sizeClass(const size_t bytes)
+    {
+        size_t shift = _minClassShift;
+        while ((size_t{1} << shift) < bytes)
+        {
+            ++shift;
+        }
+        return shift;
+    }
+
+    static size_t roundUp(const size_t n, const size_t multiple) { return (n + multiple - 1) / multiple * multiple; }
+
+    static std::string errorString(const std::string& what) { return what + ", " + std::strerror(errno); }
+
+    // Map size bytes starting on a huge page boundary, so that every page of it can be a transparent
+    // huge page. Maps an extra huge page and unmaps the slack either side of the aligned range.
+    static void* mapAligned(const size_t size)
+    {
+        void* const region =
+            mmap(nullptr, size + _hugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED)
+        {
+            return MAP_FAILED;
+        }
+        char* const start = static_cast<char*>(region);
+        const uintptr_t address = reinterpret_cast<uintptr_t>(start);
+        char* const aligned = start + (roundUp(address, _hugePageSize) - address);
+        if (aligned != start)
+        {
+            munmap(start, static_cast<size_t>(aligned - start));
+        }
+        const size_t tail = static_cast<size_t>(start + size + _hugePageSize - (aligned + size));
+        if (tail > 0)
+        {
+            munmap(aligned + size, tail);
+        }
+        return aligned;
+    }
+
+    // Bind the region to node. The node mask spans as many words as the node number needs.
+    void bind(const int node)
+    {
+        constexpr size_t bitsPerWord = sizeof(unsigned long) * CHAR_BIT;
+        const size_t bit = static_cast<size_t>(node);
+        std::vector<unsigned long> nodeMask(bit / bitsPerWord + 1, 0);
+        nodeMask[bit / bitsPerWord] = 1UL << (bit % bitsPerWord);
+        // The kernel reads one bit fewer than maxnode
+        const unsigned long maxNode = nodeMask.size() * bitsPerWord + 1;
+        if (syscall(SYS_mbind, _begin, _mappedSize, MPOL_BIND, nodeMask.data(), maxNode, 0) != 0)
+        {
+            const std::string error = errorString("Failed to bind huge page arena to node " + std::to_string(node));
+            munmap(_begin, _mappedSize);
+            throw std::runtime_error(error);
+        }
+    }
+
+public:
+    static constexpr int noNode = -1;
+    static constexpr size_t maxAlignment = 64;
+
+    // Map at least size bytes. If node is not noNode the pages are bound to that NUMA node.
+    explicit HugePageArena(const size_t size, const int node = noNode, const bool prefault = true)
+        : _mappedSize(roundUp(size, _hugePageSize)), _hugeTlb(true)
+    {
+        if (node < noNode)
+        {
+            throw std::invalid_argument("Invalid NUMA node, " + std::to_string(node));
+        }
+
+        void* region =
+            mmap(nullptr, _mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (region == MAP_FAILED)
+        {
+            // No explicit huge pages reserved, ask for transparent huge pages instead
+            _hugeTlb = false;
+            region = mapAligned(_mappedSize);
+            if (region == MAP_FAILED)
+            {
+                throw std::runtime_error(errorString("Failed to map huge page arena"));
+            }
+            madvise(region, _mappedSize, MADV_HUGEPAGE);
+        }
+        _begin = static_cast<char*>(region);
+        _next = _begin;
+        _end = _begin + _mappedSize;
+
+        if (node != noNode)
+        {
+            // Bind before touching the pages so they are faulted in on the right node
+            bind(node);
+        }
+
+        if (prefault)
+        {
+            for (size_t offset = 0; offset < _mappedSize; offset += static_cast<size_t>(getpagesize()))
+            {
+                static_cast<volatile char*>(region)[offset] = 0;
+            }
+        }
+    }
+
+    ~HugePageArena() { munmap(_begin, _mappedSize); }
+
+    HugePageArena(const HugePageArena&) = delete;
+    HugePageArena& operator=(const HugePageArena&) = delete;
+
+    void* allocate(const size_t bytes, const size_t alignment = alignof(std::max_align_t))
+    {
+        const size_t shift = sizeClass(bytes < alignment ? alignment : bytes);
+        if (shift >= _numClasses)
+        {
+            throw std::bad_alloc();
+        }
+        if (FreeBlock* block = _freeLists[shift])
+        {
+            _freeLists[shift] = block->next;
+            return block;
+        }
+
+        const size_t classSize = size_t{1} << shift;
+        // Blocks are aligned to their class size up to a cache line, which covers any supported alignment
+        const size_t blockAlignment = classSize < maxAlignment ? classSize : maxAlignment;
+        const uintptr_t next = reinterpret_cast<uintptr_t>(_next);
+        char* const result = _next + (roundUp(next, blockAlignment) - next);
+        if (result > _end || static_cast<size_t>(_end - result) < classSize)
+        {
+            throw std::bad_alloc();
+        }
+        _next = result + classSize;
+        return result;
+    }
+
+    void deallocate(void* p, const size_t bytes, const size_t alignment = alignof(std::max_align_t)) noexcept
+    {
+        const size_t shift = sizeClass(bytes < alignment ? alignment : bytes);
+        FreeBlock* block = static_cast<FreeBlock*>(p);
+        block->next = _freeLists[shift];
+        _freeLists[shift] = block;
+    }
+
+    // Size rounded up to the size class that an allocation of the given size will use
+    static size_t usableSize(const size_t bytes) { return size_t{1} << sizeClass(bytes); }
+
+    // True if backed by explicit MAP_HUGETLB pages rather than transparent huge pages
+    bool hugeTlb() const { return _hugeTlb; }
+
+    size_t capacity() const { return _mappedSize; }
+
+    size_t used() const { return static_cast<size_t>(_next - _begin); }
+};
+
+template <typename T>
+struct HugePageAllocation
+{
+    T* ptr;
+    size_t count;
+};
+
+template <typename T>
+class HugePageAllocator
+{
+    template <typename U>
+    friend class HugePageAllocator;
+
+    HugePageArena* _arena;
+
+public:
+    using value_type = T;
+
+    static_assert(alignof(T) <= HugePageArena::maxAlignment, "Over aligned types are not supported");
+
+    explicit HugePageAllocator(HugePageArena& arena) noexcept : _arena(&arena) {}
+
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U>& other) noexcept : _arena(other._arena)
+    {}
+
+    T* allocate(const size_t n) { return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T))); }
+
+    // Hand out the whole size class so that SPSCQueue can use the slack as extra capacity
+    HugePageAllocation<T> allocate_at_least(const size_t n)
+    {
+        const size_t count = HugePageArena::usableSize(n * sizeof(T) < alignof(T) ? alignof(T) : n * sizeof(T))
+                             / sizeof(T);
+        return {allocate(count), count};
+    }
+
+    void deallocate(T* p, const size_t n) noexcept { _arena->deallocate(p, n * sizeof(T), alignof(T)); }
+
+    HugePageArena& arena() const noexcept { return *_arena; }
+
+    template <typename U>
+    bool operator==(const HugePageAllocator<U>& other) const noexcept
+    {
+        return _arena == other._arena;
+    }
+
+    template <typename U>
+    bool operator!=(const HugePageAllocator<U>& other) const noexcept
+    {
+        return _arena != other._arena;
+    }
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+// IntrusivePtr.h
+// --------------
+// Reference counted pointer for types that carry their own count. A handle is a single pointer and
+// there is no control block, so sharing an object costs no allocation beyond the object itself.
+//
+// IntrusivePtr retains and releases through intrusivePtrRetain(p) and intrusivePtrRelease(p), found by
+// argument dependent lookup. Deriving from RefCounted<Derived, RefCountPolicy> provides both, counting
+// with the given policy from RefCount.h and deleting the object on the last release. A type can define
+// its own overloads instead, for example to hand the object back to a pool rather than deleting it.
+
+#include <utility>
+
+#include "lib/RefCount.h"
+
+template <typename Derived, typename RefCountPolicy = NonAtomicRefCount>
+class RefCounted
+{
+    mutable typename RefCountPolicy::Count _refCount{0};
+
+protected:
+    RefCounted() = default;
+
+    // A copy is a new object with no references to it yet
+    RefCounted(const RefCounted&) : _refCount(0) {}
+
+    RefCounted& operator=(const RefCounted&) { return *this; }
+
+    ~RefCounted() = default;
+
+public:
+    long refCount() const { return RefCountPolicy::load(_refCount); }
+
+    friend void intrusivePtrRetain(const Derived* p) noexcept
+    {
+        RefCountPolicy::increment(static_cast<const RefCounted*>(p)->_refCount);
+    }
+
+    friend void intrusivePtrRelease(const Derived* p) noexcept
+    {
+        if (RefCountPolicy::decrement(static_cast<const RefCounted*>(p)->_refCount))
+        {
+            delete p;
+        }
+    }
+};
+
+template <typename T>
+class IntrusivePtr
+{
+    T* _ptr;
+
+public:
+    IntrusivePtr() noexcept : _ptr(nullptr) {}
+
+    // Takes a new reference unless retain is false, which adopts one the caller already holds
+    IntrusivePtr(T* const ptr, const bool retain = true) noexcept : _ptr(ptr)
+    {
+        if (_ptr && retain)
+        {
+            intrusivePtrRetain(_ptr);
+        }
+    }
+
+    IntrusivePtr(const IntrusivePtr& other) noexcept : IntrusivePtr(other._ptr) {}
+
+    IntrusivePtr(IntrusivePtr&& other) noexcept : _ptr(other._ptr) { other._ptr = nullptr; }
+
+    ~IntrusivePtr()
+    {
+        if (_ptr)
+        {
+            intrusivePtrRelease(_ptr);
+        }
+    }
+
+    IntrusivePtr& operator=(const IntrusivePtr& other) noexcept
+    {
+        IntrusivePtr(other).swap(*this);
+        return *this;
+    }
+
+    IntrusivePtr& operator=(IntrusivePtr&& other) noexcept
+    {
+        IntrusivePtr(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    void reset() noexcept { IntrusivePtr().swap(*this); }
+
+    void reset(T* const ptr, const bool retain = true) noexcept { IntrusivePtr(ptr, retain).swap(*this); }
+
+    // Give up the reference without releasing it, the caller becomes responsible for it
+    T* detach() noexcept
+    {
+        T* const ptr = _ptr;
+        _ptr = nullptr;
+        return ptr;
+    }
+
+    void swap(IntrusivePtr& other) noexcept { std::swap(_ptr, other._ptr); }
+
+    T& operator*() const noexcept { return *_ptr; }
+
+    T* operator->() const noexcept { return _ptr; }
+
+    T* get() const noexcept { return _ptr; }
+
+    explicit operator bool() const noexcept { return _ptr != nullptr; }
+
+    bool operator==(const IntrusivePtr& other) const noexcept { return _ptr == other._ptr; }
+
+    bool operator!=(const IntrusivePtr& other) const noexcept { return _ptr != other._ptr; }
+};
+
+template <typename T, typename... Args>
+IntrusivePtr<T> makeIntrusive(Args&&... args)
+{
+    return IntrusivePtr<T>(new T(std::forward<Args>(args)...));
+}
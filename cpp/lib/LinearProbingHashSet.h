@@ -1,46 +1,332 @@
 #pragma once
 
+// LinearProbingHashSet.h
+// ----------------------
+// Open addressing hash set with linear probing. Removal uses backward shift deletion, moving later
+// members of the probe chain back into the hole, so the table never holds tombstones and a lookup
+// can stop at the first empty slot.
+//
+// The capacity is always a power of two so the home slot is found with a mask instead of a divide.
+// The table grows by doubling whenever an insert would take it over the max load factor.
+//
+// How a slot marks itself empty is chosen by the Slots policy. OptionalSlot wraps every item in a
+// std::optional, which works for any T. SentinelSlot stores plain T and reserves one key value as the
+// empty marker, halving the table footprint for small integer keys such as order ids. Backward shift
+// deletion means no deleted marker is ever needed.
+//
+// Setting RobinHood keeps every probe chain ordered by distance from the home slot. An insert takes
+// the slot of any item that is closer to its home than the incoming item is, and carries the displaced
+// item further. The probe distance is derived from the hash rather than stored. This bounds the spread
+// of probe lengths at high load factors, and a miss can stop as soon as it passes an item closer to its
+// home than the key being looked up would be.
+//
+// containsBatch and insertBatch work through keys in chunks. They hash a whole chunk and prefetch every
+// home slot before resolving any probe, so the cache misses of independent keys overlap instead of
+// being paid one after another. This matters once the table is much larger than the last level cache.
+//
+// Hash and KeyEqual default to DefaultHash and std::equal_to. DefaultHash is FibonacciHash for integer
+// keys, as std::hash is the identity for them and would cluster sequential keys such as order ids into
+// long runs, and std::hash for other keys. When both Hash and KeyEqual declare is_transparent, contains
+// and remove also accept any key type they can hash and compare, e.g. std::string_view against
+// std::string keys, without building a temporary T.
+
+#include <algorithm>
+#include <cmath>
+#include <functional>  // std::equal_to
 #include <optional>
+#if __has_include(<span>)
+#include <span>
+#endif
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "lib/Hash.h"
+
+struct ProbeStats
+{
+    // Probe length is the distance of an item from its home slot, 0 when it sits in its home slot
+    size_t maxProbeLength;
+    double meanProbeLength;
+    // histogram[i] is the number of items with probe length i
+    std::vector<size_t> histogram;
+};
+
 template <typename T>
+struct OptionalSlot
+{
+    using Slot = std::optional<T>;
+
+    static Slot empty() { return std::nullopt; }
+
+    static bool isEmpty(const Slot& slot) { return !slot.has_value(); }
+
+    template <typename K>
+    static bool isEmptyKey(const K&)
+    {
+        return false;
+    }
+
+    static const T& get(const Slot& slot) { return *slot; }
+
+    static T& get(Slot& slot) { return *slot; }
+};
+
+// EmptyKey can never be inserted into the set
+template <typename T, T EmptyKey>
+struct SentinelSlot
+{
+    using Slot = T;
+
+    static Slot empty() { return EmptyKey; }
+
+    static bool isEmpty(const Slot& slot) { return slot == EmptyKey; }
+
+    template <typename K>
+    static bool isEmptyKey(const K& item)
+    {
+        return item == EmptyKey;
+    }
+
+    static const T& get(const Slot& slot) { return slot; }
+
+    static T& get(Slot& slot) { return slot; }
+};
+
+template <typename T,
+          typename Slots = OptionalSlot<T>,
+          bool RobinHood = false,
+          typename Hash = DefaultHash<T>,
+          typename KeyEqual = std::equal_to<T>>
 class LinearProbingHashSet
 {
+    using Slot = typename Slots::Slot;
+
+    static constexpr size_t _minCapacity = 8;
+
     size_t _size;
-    std::hash<T> _hasher;
-    std::vector<std::optional<T>> _items;
+    float _maxLoadFactor;
+#if defined(__has_cpp_attribute) && __has_cpp_attribute(no_unique_address)
+    Hash _hasher [[no_unique_address]];
+    KeyEqual _equal [[no_unique_address]];
+#else
+    Hash _hasher;
+    KeyEqual _equal;
+#endif
+    std::vector<Slot> _items;
+
+    static size_t roundUpToPowerOfTwo(const size_t n)
+    {
+        size_t result = 1;
+        while (result < n)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    template <typename K>
+    size_t getHash(const std::vector<Slot>& items, const K& item) const
+    {
+        return _hasher(item) & (items.size() - 1);
+    }
+
+    static size_t next(const std::vector<Slot>& items, const size_t i)
+    {
+        return (i + 1) & (items.size() - 1);
+    }
+
+    // Distance from slot from to slot to walking forward around the table
+    static size_t distance(const std::vector<Slot>& items, const size_t from, const size_t to)
+    {
+        return (to - from) & (items.size() - 1);
+    }
+
+    // Smallest power of two capacity holding count items without going over the max load factor
+    size_t capacityFor(const size_t count) const
+    {
+        const size_t needed = static_cast<size_t>(std::ceil(static_cast<double>(count) / _maxLoadFactor));
+        return roundUpToPowerOfTwo(std::max(needed, _minCapacity));
+    }
+
+    void rehash(const size_t capacity)
+    {
+        std::vector<Slot> newItems(capacity, Slots::empty());
+        for (Slot& slot : _items)
+        {
+            if (!Slots::isEmpty(slot))
+            {
+                insert(newItems, std::move(Slots::get(slot)));
+            }
+        }
+        _items = std::move(newItems);
+    }
 
-    size_t getHash(const std::vector<std::optional<T>>& items, const T& item) const
+    // Index of the item, or of the first empty slot of its probe chain. Returns items.size() if the
+    // item is absent and the table is full, or in Robin Hood mode if the miss ended early.
+    template <typename K>
+    size_t find(const std::vector<Slot>& items, const K& item) const
     {
-        return _hasher(item) % items.size();
+        return find(items, item, getHash(items, item));
     }
 
-    bool insert(std::vector<std::optional<T>>& items, const T& item)
+    template <typename K>
+    size_t find(const std::vector<Slot>& items, const K& item, const size_t hashIndex) const
     {
-        const size_t hashIndex = getHash(items, item);
         size_t i = hashIndex;
+        size_t probeLength = 0;
         do
         {
-            auto& curr = items.at(i);
-            if (curr == std::nullopt)
+            const Slot& curr = items[i];
+            if (Slots::isEmpty(curr) || _equal(Slots::get(curr), item))
             {
-                curr = item;
-                return true;
+                return i;
             }
-            else if (curr == item)
+            if constexpr (RobinHood)
             {
-                return false;
+                // The item would have displaced curr, so it cannot be further along
+                if (distance(items, getHash(items, Slots::get(curr)), i) < probeLength)
+                {
+                    return items.size();
+                }
+                ++probeLength;
             }
-            i = (i + 1) % items.size();
+            i = next(items, i);
         } while (i != hashIndex);
-        return false;
+        return items.size();
+    }
+
+    // Place an item known to be absent, swapping it with any item closer to its home slot
+    void insertRobinHood(std::vector<Slot>& items, T item)
+    {
+        size_t i = getHash(items, item);
+        size_t probeLength = 0;
+        while (!Slots::isEmpty(items[i]))
+        {
+            const size_t currProbeLength = distance(items, getHash(items, Slots::get(items[i])), i);
+            if (currProbeLength < probeLength)
+            {
+                std::swap(item, Slots::get(items[i]));
+                probeLength = currProbeLength;
+            }
+            i = next(items, i);
+            ++probeLength;
+        }
+        items[i] = std::move(item);
+    }
+
+    template <typename U>
+    bool insert(std::vector<Slot>& items, U&& item)
+    {
+        return insert(items, std::forward<U>(item), getHash(items, item));
+    }
+
+    template <typename U>
+    bool insert(std::vector<Slot>& items, U&& item, const size_t hashIndex)
+    {
+        const size_t i = find(items, item, hashIndex);
+        if constexpr (RobinHood)
+        {
+            if (i != items.size() && !Slots::isEmpty(items[i]))
+            {
+                return false;
+            }
+            // The load factor guarantees an empty slot to end the chain
+            insertRobinHood(items, std::forward<U>(item));
+            return true;
+        }
+        else
+        {
+            if (i == items.size() || !Slots::isEmpty(items[i]))
+            {
+                return false;
+            }
+            items[i] = std::forward<U>(item);
+            return true;
+        }
+    }
+
+    template <typename K>
+    bool removeKey(const K& item)
+    {
+        if (Slots::isEmptyKey(item))
+        {
+            return false;
+        }
+        size_t hole = find(_items, item);
+        if (hole == _items.size() || Slots::isEmpty(_items[hole]))
+        {
+            return false;
+        }
+
+        // Shift later members of the chain back unless that would move them before their home slot
+        for (size_t i = next(_items, hole); !Slots::isEmpty(_items[i]); i = next(_items, i))
+        {
+            const size_t home = getHash(_items, Slots::get(_items[i]));
+            if (distance(_items, home, i) >= distance(_items, hole, i))
+            {
+                _items[hole] = std::move(_items[i]);
+                hole = i;
+            }
+            else if constexpr (RobinHood)
+            {
+                // Chains are ordered by probe length, so an item in its home slot starts a new chain
+                break;
+            }
+        }
+        _items[hole] = Slots::empty();
+        --_size;
+        return true;
+    }
+
+    template <typename K>
+    const T* lookupKey(const K& item) const
+    {
+        if (Slots::isEmptyKey(item))
+        {
+            return nullptr;
+        }
+        const size_t i = find(_items, item);
+        return i != _items.size() && !Slots::isEmpty(_items[i]) ? &Slots::get(_items[i]) : nullptr;
+    }
+
+    template <typename K>
+    bool containsKey(const K& item) const
+    {
+        return lookupKey(item) != nullptr;
     }
 
 public:
-    LinearProbingHashSet(const size_t capacity) : _size(0), _items(capacity) {}
+    // The capacity is rounded up to a power of two
+    LinearProbingHashSet(const size_t capacity = _minCapacity, const float maxLoadFactor = 0.75f)
+        : _size(0),
+          _maxLoadFactor(maxLoadFactor),
+          _items(roundUpToPowerOfTwo(std::max<size_t>(capacity, 1)), Slots::empty())
+    {
+        if (!(_maxLoadFactor > 0.0f && _maxLoadFactor < 1.0f))
+        {
+            throw std::invalid_argument("Max load factor must be in (0, 1), " + std::to_string(_maxLoadFactor));
+        }
+    }
+
+    static constexpr size_t batchSize = 16;
 
     bool insert(const T& item)
     {
+        if (Slots::isEmptyKey(item))
+        {
+            throw std::invalid_argument("Cannot insert the empty key");
+        }
+        if (static_cast<double>(_size + 1) > _items.size() * static_cast<double>(_maxLoadFactor))
+        {
+            if (contains(item))
+            {
+                return false;
+            }
+            rehash(_items.size() * 2);
+        }
         if (insert(_items, item))
         {
             ++_size;
@@ -49,57 +335,187 @@ public:
         return false;
     }
 
-    bool remove(const T& item)
+    bool remove(const T& item) { return removeKey(item); }
+
+    template <typename K,
+              typename H = Hash,
+              typename E = KeyEqual,
+              typename = std::void_t<typename H::is_transparent, typename E::is_transparent>>
+    bool remove(const K& key)
     {
-        const size_t hashIndex = getHash(_items, item);
-        size_t i = hashIndex;
-        do
+        return removeKey(key);
+    }
+
+    bool contains(const T& item) const { return containsKey(item); }
+
+    template <typename K,
+              typename H = Hash,
+              typename E = KeyEqual,
+              typename = std::void_t<typename H::is_transparent, typename E::is_transparent>>
+    bool contains(const K& key) const
+    {
+        return containsKey(key);
+    }
+
+    // The stored item equal to key, or nullptr. With a transparent KeyEqual that compares items by a key
+    // field the set works as a map, looked up by the key alone. The item must not be modified in a way
+    // that changes its hash. Valid until the next insert or remove.
+    const T* lookup(const T& item) const { return lookupKey(item); }
+
+    template <typename K,
+              typename H = Hash,
+              typename E = KeyEqual,
+              typename = std::void_t<typename H::is_transparent, typename E::is_transparent>>
+    const T* lookup(const K& key) const
+    {
+        return lookupKey(key);
+    }
+
+    // out[i] is set to whether keys[i] is in the set
+    void containsBatch(const T* keys, const size_t count, bool* out) const
+    {
+        size_t homes[batchSize];
+        for (size_t begin = 0; begin < count; begin += batchSize)
         {
-            auto& curr = _items.at(i);
-            if (curr == item)
+            const size_t end = std::min(begin + batchSize, count);
+            for (size_t i = begin; i < end; ++i)
             {
-                curr = std::nullopt;
-                --_size;
-                return true;
+                homes[i - begin] = getHash(_items, keys[i]);
+                __builtin_prefetch(&_items[homes[i - begin]]);
             }
-            i = (i + 1) % _items.size();
-        } while (i != hashIndex);
-        return false;
+            for (size_t i = begin; i < end; ++i)
+            {
+                if (Slots::isEmptyKey(keys[i]))
+                {
+                    out[i] = false;
+                    continue;
+                }
+                const size_t j = find(_items, keys[i], homes[i - begin]);
+                out[i] = j != _items.size() && !Slots::isEmpty(_items[j]);
+            }
+        }
     }
 
-    bool contains(const T& item) const
+    // If inserted is not null, inserted[i] is set to whether keys[i] was added. Returns the number of
+    // keys added. Throws on the empty key, leaving the keys before it inserted.
+    size_t insertBatch(const T* keys, const size_t count, bool* inserted = nullptr)
     {
-        const size_t hashIndex = getHash(_items, item);
-        size_t i = hashIndex;
-        do
+        size_t homes[batchSize];
+        size_t total = 0;
+        for (size_t begin = 0; begin < count; begin += batchSize)
         {
-            auto& curr = _items.at(i);
-            if (curr == item)
+            const size_t end = std::min(begin + batchSize, count);
+            // Grow up front as if every key were new, so no rehash moves the prefetched slots
+            while (static_cast<double>(_size + end - begin) > _items.size() * static_cast<double>(_maxLoadFactor))
             {
-                return true;
+                rehash(_items.size() * 2);
             }
-            i = (i + 1) % _items.size();
-        } while (i != hashIndex);
-        return false;
+            for (size_t i = begin; i < end; ++i)
+            {
+                homes[i - begin] = getHash(_items, keys[i]);
+                __builtin_prefetch(&_items[homes[i - begin]], 1);
+            }
+            for (size_t i = begin; i < end; ++i)
+            {
+                if (Slots::isEmptyKey(keys[i]))
+                {
+                    throw std::invalid_argument("Cannot insert the empty key");
+                }
+                const bool added = insert(_items, keys[i], homes[i - begin]);
+                if (inserted)
+                {
+                    inserted[i] = added;
+                }
+                if (added)
+                {
+                    ++_size;
+                    ++total;
+                }
+            }
+        }
+        return total;
+    }
+
+#ifdef __cpp_lib_span
+    void containsBatch(const std::span<const T> keys, const std::span<bool> out) const
+    {
+        if (out.size() < keys.size())
+        {
+            throw std::invalid_argument("Output span is smaller than the keys");
+        }
+        containsBatch(keys.data(), keys.size(), out.data());
+    }
+
+    size_t insertBatch(const std::span<const T> keys) { return insertBatch(keys.data(), keys.size()); }
+
+    size_t insertBatch(const std::span<const T> keys, const std::span<bool> inserted)
+    {
+        if (inserted.size() < keys.size())
+        {
+            throw std::invalid_argument("Output span is smaller than the keys");
+        }
+        return insertBatch(keys.data(), keys.size(), inserted.data());
     }
+#endif
 
     size_t size() const { return _size; }
 
+    size_t capacity() const { return _items.size(); }
+
+    float loadFactor() const { return static_cast<float>(_size) / _items.size(); }
+
+    float maxLoadFactor() const { return _maxLoadFactor; }
+
+    void maxLoadFactor(const float maxLoadFactor)
+    {
+        if (!(maxLoadFactor > 0.0f && maxLoadFactor < 1.0f))
+        {
+            throw std::invalid_argument("Max load factor must be in (0, 1), " + std::to_string(maxLoadFactor));
+        }
+        _maxLoadFactor = maxLoadFactor;
+        reserve(_size);
+    }
+
+    // Rehash into the given capacity rounded up to a power of two, but never below what the current
+    // items need at the max load factor
     void resize(const size_t capacity)
     {
-        std::vector<std::optional<T>> newItems(capacity);
-        _size = 0;
+        rehash(std::max(roundUpToPowerOfTwo(std::max<size_t>(capacity, 1)), capacityFor(_size)));
+    }
+
+    // Make room for count items without any further rehash
+    void reserve(const size_t count)
+    {
+        const size_t capacity = capacityFor(count);
+        if (capacity > _items.size())
+        {
+            rehash(capacity);
+        }
+    }
+
+    // Walks the whole table, meant for monitoring and tuning rather than the hot path
+    ProbeStats probeStats() const
+    {
+        ProbeStats stats{0, 0.0, {}};
+        size_t total = 0;
         for (size_t i = 0; i < _items.size(); ++i)
         {
-            auto& item = _items.at(i);
-            if (item.has_value())
+            if (!Slots::isEmpty(_items[i]))
             {
-                if (insert(newItems, item.value()))
+                const size_t probeLength = distance(_items, getHash(_items, Slots::get(_items[i])), i);
+                if (probeLength >= stats.histogram.size())
                 {
-                    ++_size;
+                    stats.histogram.resize(probeLength + 1, 0);
                 }
+                ++stats.histogram[probeLength];
+                stats.maxProbeLength = std::max(stats.maxProbeLength, probeLength);
+                total += probeLength;
             }
         }
-        _items = std::move(newItems);
+        if (_size > 0)
+        {
+            stats.meanProbeLength = static_cast<double>(total) / _size;
+        }
+        return stats;
     }
 };
@@ -0,0 +1,82 @@
+#pragma once
+
+// ListPriceLevel.h
+// ----------------
+// Price level keeping its orders in time priority in a std::list, so an order's position stays valid
+// until it leaves the level. All containers allocate through Allocator, which is rebound as needed.
+
+#include <algorithm>
+#include <cstdint>
+#include <list>
+#include <memory>  // std::allocator, std::allocator_traits
+#include <vector>
+
+#include "lib/Fill.h"
+#include "lib/Order.h"
+
+template <typename Allocator = std::allocator<Order>>
+class BasicListPriceLevel
+{
+    template <typename U>
+    using RebindAlloc = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+
+public:
+    using OrderList = std::list<RestingOrder, RebindAlloc<RestingOrder>>;
+    using iterator = typename OrderList::iterator;
+    using Position = iterator;
+    using Context = Allocator;
+
+private:
+    PriceT price;
+    OrderList orders;
+    // Sum of the resting sizes, kept up to date so depth is O(1)
+    uint64_t total = 0;
+
+public:
+    BasicListPriceLevel(const PriceT price, const Allocator& allocator = Allocator())
+        : price(price), orders(allocator)
+    {}
+
+    inline PriceT getPrice() const { return price; }
+
+    Position add(const Order& order)
+    {
+        auto it = orders.insert(orders.end(), RestingOrder{order.oid, order.size});
+        total += order.size;
+        return it;
+    }
+
+    // Match against the resting orders in time priority, appending a fill per order traded with
+    void match(Order& order, std::vector<Fill>& fills)
+    {
+        auto it = orders.begin();
+        while (order.size > 0 && it != orders.end())
+        {
+            const SizeT size = std::min(order.size, it->size);
+            order.size -= size;
+            it->size -= size;
+            total -= size;
+            fills.push_back(Fill{price, order.oid, it->oid, size, it->size, it->size == 0});
+            if (it->size == 0)
+            {
+                it = orders.erase(it);
+            }
+        }
+    }
+
+    void cancel(const Position it)
+    {
+        total -= it->size;
+        orders.erase(it);
+    }
+
+    bool empty() const { return orders.empty(); }
+
+    size_t size() const { return orders.size(); }
+
+    uint64_t totalSize() const { return total; }
+
+    const OrderList& getOrders() const { return orders; }
+};
+
+using ListPriceLevel = BasicListPriceLevel<>;
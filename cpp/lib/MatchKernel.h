@@ -0,0 +1,122 @@
+#pragma once
+
+// MatchKernel.h
+// -------------
+// Finds how far an incoming order sweeps into the queue of resting sizes at one price level. Resting
+// orders fill in time priority, so the cutoff is the first order at which the running total of sizes
+// reaches the incoming quantity. Every order before it fills completely, and the cutoff order fills
+// by whatever quantity is left.
+//
+// With AVX2 the running total is computed eight orders at a time. Sizes are widened to 32 bits, summed
+// within each 128 bit lane by two shifts and adds, the low lane's total is added to the high lane and
+// the carry from earlier orders to all of them, then one compare finds the cutoff. Without AVX2, or
+// for the last few orders, a scalar loop does the same.
+//
+// On x86-64 the AVX2 kernel is always compiled, with a target attribute, and matchCutoff picks it at
+// run time when the CPU supports AVX2. Builds with -mavx2 skip the check.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "lib/types.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define MATCH_KERNEL_AVX2
+#endif
+
+struct MatchCutoff
+{
+    // Index of the first order where the running total reaches the quantity, or the number of orders
+    // when the quantity is more than all of them
+    size_t index;
+    // Total size of the orders before index
+    uint32_t before;
+};
+
+inline MatchCutoff matchCutoffScalar(const SizeT* sizes,
+                                     const size_t n,
+                                     const SizeT quantity,
+                                     const size_t start = 0,
+                                     uint32_t before = 0)
+{
+    for (size_t i = start; i < n; ++i)
+    {
+        if (before + sizes[i] >= quantity)
+        {
+            return {i, before};
+        }
+        before += sizes[i];
+    }
+    return {n, before};
+}
+
+#ifdef MATCH_KERNEL_AVX2
+// Whether the CPU running the program supports AVX2, checked once
+inline bool hasAvx2()
+{
+#ifdef __AVX2__
+    return true;
+#else
+    static const bool supported = []
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return supported;
+#endif
+}
+
+// Only call when hasAvx2()
+__attribute__((target("avx2"))) inline MatchCutoff matchCutoffAvx2(const SizeT* sizes,
+                                                                   const size_t n,
+                                                                   const SizeT quantity)
+{
+    static_assert(sizeof(SizeT) == 2, "The AVX2 kernel widens 16 bit sizes");
+    if (quantity == 0)
+    {
+        return {0, 0};
+    }
+
+    // The running total stops growing once it reaches the quantity, a SizeT, so it stays below 2^17 and
+    // the signed compare is safe
+    const __m256i threshold = _mm256_set1_epi32(static_cast<int>(quantity - 1));
+    const __m256i lowLaneLast = _mm256_set1_epi32(3);
+    const __m256i lastElement = _mm256_set1_epi32(7);
+    __m256i carry = _mm256_setzero_si256();
+    uint32_t before = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i sum = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(sizes + i)));
+        sum = _mm256_add_epi32(sum, _mm256_slli_si256(sum, 4));
+        sum = _mm256_add_epi32(sum, _mm256_slli_si256(sum, 8));
+        const __m256i low = _mm256_permutevar8x32_epi32(sum, lowLaneLast);
+        sum = _mm256_add_epi32(sum, _mm256_blend_epi32(_mm256_setzero_si256(), low, 0xF0));
+        sum = _mm256_add_epi32(sum, carry);
+
+        const int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(sum, threshold)));
+        if (mask != 0)
+        {
+            const int lane = __builtin_ctz(static_cast<unsigned>(mask));
+            alignas(32) uint32_t totals[8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(totals), sum);
+            return {i + lane, totals[lane] - sizes[i + lane]};
+        }
+        carry = _mm256_permutevar8x32_epi32(sum, lastElement);
+        before = static_cast<uint32_t>(_mm256_extract_epi32(sum, 7));
+    }
+    return matchCutoffScalar(sizes, n, quantity, i, before);
+}
+#endif
+
+inline MatchCutoff matchCutoff(const SizeT* sizes, const size_t n, const SizeT quantity)
+{
+#ifdef MATCH_KERNEL_AVX2
+    if (hasAvx2())
+    {
+        return matchCutoffAvx2(sizes, n, quantity);
+    }
+#endif
+    return matchCutoffScalar(sizes, n, quantity);
+}
@@ -3,10 +3,21 @@
 #include "lib/Side.h"
 #include "lib/types.h"
 
+// Ordered so that the oid, size and one byte side share the first eight bytes and the whole order fits
+// in 16, four orders to a cache line
 struct Order
 {
     OrderIdT oid;
+    SizeT size;
     Side side;
     PriceT price;
+};
+
+static_assert(sizeof(Order) == 16, "Order should pack into 16 bytes");
+
+// An order resting in a price level, which already knows the price and side
+struct RestingOrder
+{
+    OrderIdT oid;
     SizeT size;
 };
@@ -0,0 +1,675 @@
+#pragma once
+
+// OrderBook.h
+// -----------
+// Price time priority order book assembled from policies at compile time. Every combination is a
+// separate type with all calls resolved statically, so a book can be tuned per instrument class and
+// combinations benchmarked without forking the matching logic.
+//
+// PricePolicy turns prices into the keys levels are indexed by. DoublePrice uses the price itself,
+// TickPrice<TicksPerUnit> rounds it to an integer number of ticks and throws std::out_of_range for a
+// price too large for an int64_t tick. add() rejects prices that are not finite before either is used.
+//
+// LevelContainer holds the orders of one price level: ListLevels, VectorLevels or ChunkedLevels<N>, see
+// ListPriceLevel.h, VectorPriceLevel.h and ChunkedPriceLevel.h. A level type declares the Position
+// returned by add() and taken by cancel(), and the Context shared by all levels of a book that it is
+// constructed with, the allocator or a chunk pool.
+//
+// LevelIndex arranges the levels of each side. MapLevelIndex keeps them in a std::map,
+// SortedVectorLevelIndex in a vector with the best level at the back, and TickArrayLevelIndex<Min, Max>
+// in an array with a slot for every tick from Min to Max, tracking the best one. An index throws from
+// checkKey() for a price it cannot hold, which add() calls before touching the book.
+//
+// OrderIndex maps an oid to where the order rests. HashOrderIndex uses std::unordered_map and
+// OpenAddressingOrderIndex<Hash> a LinearProbingHashSet of oid and location pairs.
+//
+// FillSink decides what add() returns. VectorFillSink returns a new vector of fills, BufferFillSink a
+// reference to the book's own buffer that is reused by the next add(), and CallbackFillSink<F> hands
+// each fill to F and returns the number of fills.
+//
+// All containers allocate through Allocator, which is rebound as needed, except for the open addressing
+// oid index which always uses std::allocator. MapOrderBook.h and VectorOrderBook.h define the original
+// two books as combinations of these policies.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>  // std::greater, std::less
+#include <map>
+#include <memory>  // std::allocator, std::allocator_traits
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "lib/BookSnapshot.h"
+#include "lib/ChunkedPriceLevel.h"
+#include "lib/Fill.h"
+#include "lib/Hash.h"
+#include "lib/LinearProbingHashSet.h"
+#include "lib/ListPriceLevel.h"
+#include "lib/Order.h"
+#include "lib/VectorPriceLevel.h"
+
+// Price policies
+
+struct DoublePrice
+{
+    using Key = PriceT;
+
+    static Key toKey(const PriceT price) { return price; }
+
+    static PriceT toPrice(const Key key) { return key; }
+};
+
+template <int64_t TicksPerUnit>
+struct TickPrice
+{
+    static_assert(TicksPerUnit > 0, "There must be at least one tick per unit of price");
+
+    using Key = int64_t;
+
+    static Key toKey(const PriceT price)
+    {
+        // llround has no defined result outside the int64_t range, which starts at -2^63 and ends just below 2^63
+        const double ticks = std::round(price * TicksPerUnit);
+        if (!(ticks >= -0x1p63 && ticks < 0x1p63))
+        {
+            throw std::out_of_range("Price too large for a tick, " + std::to_string(price));
+        }
+        return static_cast<Key>(ticks);
+    }
+
+    static PriceT toPrice(const Key key) { return static_cast<PriceT>(key) / TicksPerUnit; }
+};
+
+// Level containers
+
+struct ListLevels
+{
+    template <typename Allocator>
+    using Level = BasicListPriceLevel<Allocator>;
+};
+
+struct VectorLevels
+{
+    template <typename Allocator>
+    using Level = BasicVectorPriceLevel<Allocator>;
+};
+
+template <size_t ChunkSize = 16>
+struct ChunkedLevels
+{
+    template <typename Allocator>
+    using Level = BasicChunkedPriceLevel<ChunkSize, Allocator>;
+};
+
+// Level indexes. Better orders keys best first, std::greater for bids and std::less for asks.
+
+template <typename Key, typename Level, typename Better, typename Allocator>
+class MapLevels
+{
+    using LevelMap =
+        std::map<Key,
+                 Level,
+                 Better,
+                 typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<const Key, Level>>>;
+
+    LevelMap levels;
+
+public:
+    explicit MapLevels(const Allocator& allocator) : levels(allocator) {}
+
+    static void checkKey(const Key) {}
+
+    bool empty() const { return levels.empty(); }
+
+    size_t size() const { return levels.size(); }
+
+    // Whether an order on the other side with the given limit trades with the best level
+    bool crosses(const Key limit) const { return !levels.empty() && !Better()(limit, levels.begin()->first); }
+
+    Level& best() { return levels.begin()->second; }
+
+    void eraseBest() { levels.erase(levels.begin()); }
+
+    Level* find(const Key key)
+    {
+        auto it = levels.find(key);
+        return it == levels.end() ? nullptr : &it->second;
+    }
+
+    template <typename... Args>
+    Level& findOrCreate(const Key key, Args&&... args)
+    {
+        return levels.try_emplace(key, std::forward<Args>(args)...).first->second;
+    }
+
+    void erase(const Key key) { levels.erase(key); }
+
+    // Call f(level) for up to depth levels, best first
+    template <typename F>
+    void forEach(const size_t depth, F&& f) const
+    {
+        size_t n = 0;
+        for (auto it = levels.begin(); it != levels.end() && n < depth; ++it, ++n)
+        {
+            f(it->second);
+        }
+    }
+
+    const LevelMap& getLevels() const { return levels; }
+};
+
+struct MapLevelIndex
+{
+    template <typename Key, typename Level, typename Better, typename Allocator>
+    using Levels = MapLevels<Key, Level, Better, Allocator>;
+};
+
+// Levels sorted worst first so the best level is at the back and leaves without shifting the others.
+// The keys are kept in a parallel vector, so the search for a level scans only keys.
+template <typename Key, typename Level, typename Better, typename Allocator>
+class SortedVectorLevels
+{
+    template <typename U>
+    using RebindAlloc = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+
+    std::vector<Key, RebindAlloc<Key>> keys;
+    std::vector<Level, RebindAlloc<Level>> levels;
+
+    // One past the level with key, or where it would be inserted, searching from the best level as
+    // most activity is near the top of the book
+    size_t upperBound(const Key key) const
+    {
+        size_t i = keys.size();
+        while (i > 0 && Better()(keys[i - 1], key))
+        {
+            --i;
+        }
+        return i;
+    }
+
+public:
+    explicit SortedVectorLevels(const Allocator& allocator) : keys(allocator), levels(allocator) {}
+
+    static void checkKey(const Key) {}
+
+    bool empty() const { return levels.empty(); }
+
+    size_t size() const { return levels.size(); }
+
+    bool crosses(const Key limit) const { return !keys.empty() && !Better()(limit, keys.back()); }
+
+    Level& best() { return levels.back(); }
+
+    void eraseBest()
+    {
+        keys.pop_back();
+        levels.pop_back();
+    }
+
+    Level* find(const Key key)
+    {
+        const size_t i = upperBound(key);
+        return i > 0 && keys[i - 1] == key ? &levels[i - 1] : nullptr;
+    }
+
+    template <typename... Args>
+    Level& findOrCreate(const Key key, Args&&... args)
+    {
+        const size_t i = upperBound(key);
+        if (i > 0 && keys[i - 1] == key)
+        {
+            return levels[i - 1];
+        }
+        keys.insert(keys.begin() + i, key);
+        return *levels.emplace(levels.begin() + i, std::forward<Args>(args)...);
+    }
+
+    void erase(const Key key)
+    {
+        const size_t i = upperBound(key);
+        if (i > 0 && keys[i - 1] == key)
+        {
+            keys.erase(keys.begin() + (i - 1));
+            levels.erase(levels.begin() + (i - 1));
+        }
+    }
+
+    template <typename F>
+    void forEach(const size_t depth, F&& f) const
+    {
+        size_t n = 0;
+        for (auto it = levels.rbegin(); it != levels.rend() && n < depth; ++it, ++n)
+        {
+            f(*it);
+        }
+    }
+
+    const std::vector<Level, RebindAlloc<Level>>& getLevels() const { return levels; }
+};
+
+struct SortedVectorLevelIndex
+{
+    template <typename Key, typename Level, typename Better, typename Allocator>
+    using Levels = SortedVectorLevels<Key, Level, Better, Allocator>;
+};
+
+// A slot for every tick from MinTick to MaxTick inclusive, so finding a level is an array index. A level
+// is created the first time its tick is used and kept when it empties, ready for the next order at that
+// price. The best non empty tick is tracked, and found again by scanning away from the top of the book
+// when the best level empties. Prices outside the range throw std::out_of_range.
+template <int64_t MinTick, int64_t MaxTick, typename Key, typename Level, typename Better, typename Allocator>
+class TickArrayLevels
+{
+    static_assert(std::is_integral<Key>::value, "TickArrayLevelIndex needs integer keys, e.g. from TickPrice");
+    static_assert(MinTick <= MaxTick, "The tick range is empty");
+
+    using Slot = std::optional<Level>;
+
+    // Walking towards worse prices steps down for bids and up for asks
+    static constexpr int64_t _worse = Better()(1, 0) ? -1 : 1;
+
+    std::vector<Slot, typename std::allocator_traits<Allocator>::template rebind_alloc<Slot>> slots;
+    // Index of the best non empty level, meaningless when count is 0
+    int64_t bestIndex = 0;
+    size_t count = 0;
+
+    static size_t index(const Key key)
+    {
+        if (key < MinTick || key > MaxTick)
+        {
+            throw std::out_of_range("Price outside the tick array, " + std::to_string(key));
+        }
+        return static_cast<size_t>(key - MinTick);
+    }
+
+    bool live(const int64_t i) const { return slots[i].has_value() && !slots[i]->empty(); }
+
+    // After the best level empties, find the next non empty one
+    void advance()
+    {
+        if (--count == 0)
+        {
+            return;
+        }
+        do
+        {
+            bestIndex += _worse;
+        } while (!live(bestIndex));
+    }
+
+public:
+    explicit TickArrayLevels(const Allocator& allocator) : slots(MaxTick - MinTick + 1, allocator) {}
+
+    static void checkKey(const Key key) { index(key); }
+
+    bool empty() const { return count == 0; }
+
+    size_t size() const { return count; }
+
+    bool crosses(const Key limit) const { return count > 0 && !Better()(limit, bestIndex + MinTick); }
+
+    Level& best() { return *slots[bestIndex]; }
+
+    void eraseBest() { advance(); }
+
+    Level* find(const Key key)
+    {
+        Slot& slot = slots[index(key)];
+        return slot.has_value() ? &*slot : nullptr;
+    }
+
+    // The caller adds an order to the level straight away, so it is counted as non empty here
+    template <typename... Args>
+    Level& findOrCreate(const Key key, Args&&... args)
+    {
+        const int64_t i = static_cast<int64_t>(index(key));
+        Slot& slot = slots[i];
+        if (!slot.has_value())
+        {
+            slot.emplace(std::forward<Args>(args)...);
+        }
+        if (slot->empty())
+        {
+            if (count++ == 0 || Better()(key, bestIndex + MinTick))
+            {
+                bestIndex = i;
+            }
+        }
+        return *slot;
+    }
+
+    // Called once the level at key has emptied
+    void erase(const Key key)
+    {
+        const int64_t i = static_cast<int64_t>(index(key));
+        if (i == bestIndex)
+        {
+            advance();
+        }
+        else
+        {
+            --count;
+        }
+    }
+
+    template <typename F>
+    void forEach(const size_t depth, F&& f) const
+    {
+        // Stops at the last live level rather than scanning empty ticks to the end of the range
+        const size_t limit = std::min(depth, count);
+        size_t n = 0;
+        for (int64_t i = bestIndex; n < limit; i += _worse)
+        {
+            if (live(i))
+            {
+                f(*slots[i]);
+                ++n;
+            }
+        }
+    }
+
+    const auto& getLevels() const { return slots; }
+};
+
+template <int64_t MinTick, int64_t MaxTick>
+struct TickArrayLevelIndex
+{
+    template <typename Key, typename Level, typename Better, typename Allocator>
+    using Levels = TickArrayLevels<MinTick, MaxTick, Key, Level, Better, Allocator>;
+};
+
+// Order indexes
+
+template <typename Location, typename Allocator>
+class HashOrders
+{
+    std::unordered_map<OrderIdT,
+                       Location,
+                       std::hash<OrderIdT>,
+                       std::equal_to<OrderIdT>,
+                       typename std::allocator_traits<Allocator>::template rebind_alloc<
+                           std::pair<const OrderIdT, Location>>>
+        orders;
+
+public:
+    explicit HashOrders(const Allocator& allocator) : orders(allocator) {}
+
+    bool contains(const OrderIdT oid) const { return orders.find(oid) != orders.end(); }
+
+    void insert(const OrderIdT oid, const Location& location) { orders.emplace(oid, location); }
+
+    const Location* find(const OrderIdT oid) const
+    {
+        auto it = orders.find(oid);
+        return it == orders.end() ? nullptr : &it->second;
+    }
+
+    void erase(const OrderIdT oid) { orders.erase(oid); }
+};
+
+struct HashOrderIndex
+{
+    template <typename Location, typename Allocator>
+    using Orders = HashOrders<Location, Allocator>;
+};
+
+template <typename Hash, typename Location, typename Allocator>
+class OpenAddressingOrders
+{
+    struct Entry
+    {
+        OrderIdT oid;
+        Location location;
+    };
+
+    // Hash and compare entries by oid alone, so entries are looked up and removed by oid
+    struct EntryHash
+    {
+        using is_transparent = void;
+
+        size_t operator()(const OrderIdT oid) const { return Hash()(oid); }
+
+        size_t operator()(const Entry& entry) const { return Hash()(entry.oid); }
+    };
+
+    struct EntryEqual
+    {
+        using is_transparent = void;
+
+        static OrderIdT keyOf(const OrderIdT oid) { return oid; }
+
+        static OrderIdT keyOf(const Entry& entry) { return entry.oid; }
+
+        template <typename A, typename B>
+        bool operator()(const A& a, const B& b) const
+        {
+            return keyOf(a) == keyOf(b);
+        }
+    };
+
+    LinearProbingHashSet<Entry, OptionalSlot<Entry>, false, EntryHash, EntryEqual> orders;
+
+public:
+    explicit OpenAddressingOrders(const Allocator&) {}
+
+    bool contains(const OrderIdT oid) const { return orders.contains(oid); }
+
+    void insert(const OrderIdT oid, const Location& location) { orders.insert(Entry{oid, location}); }
+
+    const Location* find(const OrderIdT oid) const
+    {
+        const Entry* entry = orders.lookup(oid);
+        return entry ? &entry->location : nullptr;
+    }
+
+    void erase(const OrderIdT oid) { orders.remove(oid); }
+};
+
+template <typename Hash = FibonacciHash>
+struct OpenAddressingOrderIndex
+{
+    template <typename Location, typename Allocator>
+    using Orders = OpenAddressingOrders<Hash, Location, Allocator>;
+};
+
+// Fill sinks, called once per add() with the fills of the order
+
+struct VectorFillSink
+{
+    using Result = std::vector<Fill>;
+
+    Result operator()(const std::vector<Fill>& fills) const { return fills; }
+};
+
+struct BufferFillSink
+{
+    using Result = const std::vector<Fill>&;
+
+    Result operator()(const std::vector<Fill>& fills) const { return fills; }
+};
+
+template <typename F>
+struct CallbackFillSink
+{
+    using Result = size_t;
+
+    F callback;
+
+    Result operator()(const std::vector<Fill>& fills)
+    {
+        for (const Fill& fill : fills)
+        {
+            callback(fill);
+        }
+        return fills.size();
+    }
+};
+
+template <typename PricePolicy = DoublePrice,
+          typename LevelContainer = ListLevels,
+          typename LevelIndex = MapLevelIndex,
+          typename OrderIndex = HashOrderIndex,
+          typename FillSink = VectorFillSink,
+          typename Allocator = std::allocator<Order>>
+class OrderBook
+{
+    using Key = typename PricePolicy::Key;
+    using Level = typename LevelContainer::template Level<Allocator>;
+    using Position = typename Level::Position;
+    using Bids = typename LevelIndex::template Levels<Key, Level, std::greater<Key>, Allocator>;
+    using Asks = typename LevelIndex::template Levels<Key, Level, std::less<Key>, Allocator>;
+
+    struct OrderLocation
+    {
+        Key key;
+        Side side;
+        Position position;
+    };
+
+    using Orders = typename OrderIndex::template Orders<OrderLocation, Allocator>;
+
+    Allocator allocator;
+    // Declared before the levels, which may hold on to it until they are destroyed
+    typename Level::Context context;
+    Bids bids;
+    Asks asks;
+    Orders orders;
+    FillSink sink;
+    // Reused by every add() so matching does not allocate once it has grown
+    std::vector<Fill> fills;
+
+public:
+    explicit OrderBook(const Allocator& allocator = Allocator(), FillSink sink = FillSink())
+        : allocator(allocator),
+          context(allocator),
+          bids(allocator),
+          asks(allocator),
+          orders(allocator),
+          sink(std::move(sink))
+    {}
+
+    OrderBook(const OrderBook&) = delete;
+    OrderBook& operator=(const OrderBook&) = delete;
+
+    typename FillSink::Result add(const OrderIdT oid, const std::string& side, const PriceT price, const SizeT size)
+    {
+        if (orders.contains(oid))
+        {
+            throw std::runtime_error("Duplicate order id, " + std::to_string(oid));
+        }
+        // A NaN limit compares as crossing every level, and could never be found again to cancel
+        if (!std::isfinite(price))
+        {
+            throw std::runtime_error("Price is not finite, " + std::to_string(price));
+        }
+
+        fills.clear();
+        if (side == "B")
+        {
+            addOrder(bids, asks, Order{oid, size, Side::BID, price});
+        }
+        else if (side == "A")
+        {
+            addOrder(asks, bids, Order{oid, size, Side::ASK, price});
+        }
+        else
+        {
+            throw std::runtime_error("Unknown side, " + side);
+        }
+        return sink(fills);
+    }
+
+    bool cancel(const OrderIdT oid)
+    {
+        const OrderLocation* found = orders.find(oid);
+        if (!found)
+        {
+            return false;
+        }
+        const OrderLocation location = *found;
+        orders.erase(oid);
+        if (location.side == Side::BID)
+        {
+            cancelIn(bids, location);
+        }
+        else
+        {
+            cancelIn(asks, location);
+        }
+        return true;
+    }
+
+    const auto& getBids() const { return bids.getLevels(); }
+
+    const auto& getAsks() const { return asks.getLevels(); }
+
+    // Up to depth levels of each side, for publishing to other threads
+    BookSnapshot snapshot(const size_t depth) const
+    {
+        BookSnapshot result;
+        result.bids.reserve(std::min(depth, bids.size()));
+        bids.forEach(depth, [&](const Level& level) { result.bids.push_back(depthLevel(level)); });
+        result.asks.reserve(std::min(depth, asks.size()));
+        asks.forEach(depth, [&](const Level& level) { result.asks.push_back(depthLevel(level)); });
+        return result;
+    }
+
+private:
+    static DepthLevel depthLevel(const Level& level)
+    {
+        return DepthLevel{level.getPrice(), level.totalSize(), static_cast<uint32_t>(level.size())};
+    }
+
+    // Match against the opposite side while the order crosses it, then rest what is left. The key is
+    // checked first, so a price the index cannot hold throws before any resting order is filled.
+    template <typename Same, typename Opposite>
+    void addOrder(Same& same, Opposite& opposite, Order order)
+    {
+        const Key key = PricePolicy::toKey(order.price);
+        same.checkKey(key);
+        while (order.size > 0 && opposite.crosses(key))
+        {
+            Level& level = opposite.best();
+            const size_t first = fills.size();
+            level.match(order, fills);
+            for (size_t i = first; i < fills.size(); ++i)
+            {
+                if (fills[i].passiveFilled)
+                {
+                    orders.erase(fills[i].passiveOid);
+                }
+            }
+            if (level.empty())
+            {
+                opposite.eraseBest();
+            }
+        }
+
+        if (order.size > 0)
+        {
+            Level& level = same.findOrCreate(key, PricePolicy::toPrice(key), context);
+            orders.insert(order.oid, OrderLocation{key, order.side, level.add(order)});
+        }
+    }
+
+    template <typename Levels>
+    void cancelIn(Levels& levels, const OrderLocation& location)
+    {
+        Level* const level = levels.find(location.key);
+        if (!level)
+        {
+            return;
+        }
+        level->cancel(location.position);
+        if (level->empty())
+        {
+            levels.erase(location.key);
+        }
+    }
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+// RefCount.h
+// ----------
+// Reference count policies shared by SharedPtr and IntrusivePtr. NonAtomicRefCount is a plain integer
+// for objects that never leave one thread. AtomicRefCount makes copies and releases safe across
+// threads: increments are relaxed since a new reference can only be made from an existing one, and
+// decrements are acq_rel so the thread dropping the last reference sees every write made through the
+// others before it deletes the object.
+
+#include <atomic>
+
+struct NonAtomicRefCount
+{
+    using Count = long;
+
+    static void increment(Count& count) { ++count; }
+
+    // True if this was the last reference
+    static bool decrement(Count& count) { return --count == 0; }
+
+    static long load(const Count& count) { return count; }
+};
+
+struct AtomicRefCount
+{
+    using Count = std::atomic<long>;
+
+    static void increment(Count& count) { count.fetch_add(1, std::memory_order_relaxed); }
+
+    static bool decrement(Count& count) { return count.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+    static long load(const Count& count) { return count.load(std::memory_order_relaxed); }
+};
@@ -0,0 +1,227 @@
+#pragma once
+
+// SPMCBroadcastRing.h
+// -------------------
+// SPMCBroadcastRing defines a single producer multi consumer lock free ring where every consumer
+// sees every element, in the style of the LMAX disruptor. Each consumer owns a cursor on its own
+// cache line. The producer only overwrites a slot once the slowest consumer has moved past it, and
+// keeps a cached minimum of the consumer cursors so that it only scans them when the ring looks full.
+//
+// The capacity is rounded up to a power of two and sequences are free running 64 bit counters which
+// are masked into the slot array, as in the PowerOfTwo mode of SPSCQueue.
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>  // std::allocator, std::unique_ptr
+#include <new>     // std::hardware_destructive_interference_size
+#include <stdexcept>
+#include <type_traits>
+
+template <typename T, typename Allocator = std::allocator<T>>
+class SPMCBroadcastRing
+{
+#ifdef __cpp_lib_hardware_interference_size
+    static constexpr size_t _cacheLineSize = std::hardware_destructive_interference_size;
+#else
+    static constexpr size_t _cacheLineSize = 64;
+#endif
+
+    struct alignas(_cacheLineSize) Cursor
+    {
+        // Sequence of the next element to read, written by the owning consumer only
+        std::atomic<uint64_t> readSequence{0};
+        // Use to reduce the amount of cache coherency traffic
+        uint64_t writeSequenceCache{0};
+    };
+
+#if defined(__has_cpp_attribute) && __has_cpp_attribute(no_unique_address)
+    Allocator _allocator [[no_unique_address]];
+#else
+    Allocator _allocator;
+#endif
+
+    // Pad to avoid false sharing between slots and adjacent allocations
+    static constexpr size_t _padding = (_cacheLineSize - 1) / sizeof(T) + 1;
+
+    size_t _capacity;
+    size_t _mask;
+    T* _slots;
+    size_t _numConsumers;
+    std::unique_ptr<Cursor[]> _cursors;
+
+    // Align to cache line size in order to avoid false sharing.
+    alignas(_cacheLineSize) std::atomic<uint64_t> _writeSequence{0};
+    // Cached minimum of the consumer cursors, only touched by the producer
+    alignas(_cacheLineSize) uint64_t _gatingSequenceCache{0};
+
+    static size_t roundUpToPowerOfTwo(const size_t n)
+    {
+        size_t result = 1;
+        while (result < n)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    uint64_t minReadSequence() const noexcept
+    {
+        uint64_t result = _cursors[0].readSequence.load(std::memory_order_acquire);
+        for (size_t i = 1; i < _numConsumers; ++i)
+        {
+            const uint64_t sequence = _cursors[i].readSequence.load(std::memory_order_acquire);
+            if (sequence < result)
+            {
+                result = sequence;
+            }
+        }
+        return result;
+    }
+
+    T* slot(const uint64_t sequence) const noexcept { return &_slots[(sequence & _mask) + _padding]; }
+
+    // The slot for writeSequence still holds the element from one lap ago once the ring has wrapped
+    void recycle(const uint64_t writeSequence) noexcept
+    {
+        if (writeSequence >= _capacity)
+        {
+            slot(writeSequence)->~T();
+        }
+    }
+
+public:
+    SPMCBroadcastRing(const size_t capacity, const size_t numConsumers)
+        : _capacity(capacity < 1 ? 1 : capacity), _numConsumers(numConsumers)
+    {
+        static_assert(std::is_nothrow_destructible<T>::value, "T must be nothrow destructible");
+        if (_numConsumers < 1)
+        {
+            throw std::invalid_argument("SPMCBroadcastRing needs at least one consumer");
+        }
+        if (_capacity > (SIZE_MAX >> 1) - 2 * _padding)
+        {
+            throw std::length_error("SPMCBroadcastRing capacity too large");
+        }
+        _capacity = roundUpToPowerOfTwo(_capacity);
+        _mask = _capacity - 1;
+        _cursors.reset(new Cursor[_numConsumers]);
+        _slots = std::allocator_traits<Allocator>::allocate(_allocator, _capacity + 2 * _padding);
+    }
+
+    ~SPMCBroadcastRing()
+    {
+        const uint64_t writeSequence = _writeSequence.load(std::memory_order_relaxed);
+        const uint64_t live = writeSequence < _capacity ? writeSequence : _capacity;
+        for (uint64_t sequence = writeSequence - live; sequence != writeSequence; ++sequence)
+        {
+            slot(sequence)->~T();
+        }
+        std::allocator_traits<Allocator>::deallocate(_allocator, _slots, _capacity + 2 * _padding);
+    }
+
+    SPMCBroadcastRing(const SPMCBroadcastRing&) = delete;
+    SPMCBroadcastRing& operator=(const SPMCBroadcastRing&) = delete;
+
+    template <typename... Args>
+    void emplace(Args&&... args) noexcept(std::is_nothrow_constructible<T, Args&&...>::value)
+    {
+        static_assert(std::is_constructible<T, Args&&...>::value, "T is not constructible with Args");
+        const uint64_t writeSequence = _writeSequence.load(std::memory_order_relaxed);
+        while (writeSequence - _gatingSequenceCache == _capacity)
+        {
+            _gatingSequenceCache = minReadSequence();
+        }
+        recycle(writeSequence);
+        new (slot(writeSequence)) T(std::forward<Args>(args)...);
+        _writeSequence.store(writeSequence + 1, std::memory_order_release);
+    }
+
+    template <typename... Args>
+    bool try_emplace(Args&&... args) noexcept(std::is_nothrow_constructible<T, Args&&...>::value)
+    {
+        static_assert(std::is_constructible<T, Args&&...>::value, "T is not constructible with Args");
+        const uint64_t writeSequence = _writeSequence.load(std::memory_order_relaxed);
+        if (writeSequence - _gatingSequenceCache == _capacity)
+        {
+            _gatingSequenceCache = minReadSequence();
+            if (writeSequence - _gatingSequenceCache == _capacity)
+            {
+                return false;
+            }
+        }
+        recycle(writeSequence);
+        new (slot(writeSequence)) T(std::forward<Args>(args)...);
+        _writeSequence.store(writeSequence + 1, std::memory_order_release);
+        return true;
+    }
+
+    void push(const T& v) noexcept(std::is_nothrow_copy_constructible<T>::value)
+    {
+        static_assert(std::is_copy_constructible<T>::value, "T must be copy constructible");
+        emplace(v);
+    }
+
+    template <typename P, typename = typename std::enable_if<std::is_constructible<T, P&&>::value>::type>
+    void push(P&& v) noexcept(std::is_nothrow_constructible<T, P&&>::value)
+    {
+        emplace(std::forward<P>(v));
+    }
+
+    bool try_push(const T& v) noexcept(std::is_nothrow_copy_constructible<T>::value)
+    {
+        static_assert(std::is_copy_constructible<T>::value, "T must be copy constructible");
+        return try_emplace(v);
+    }
+
+    // Each consumer must only be driven by a single thread. The element stays valid until pop(consumer).
+    const T* front(const size_t consumer) noexcept
+    {
+        assert(consumer < _numConsumers);
+        Cursor& cursor = _cursors[consumer];
+        const uint64_t readSequence = cursor.readSequence.load(std::memory_order_relaxed);
+        if (readSequence == cursor.writeSequenceCache)
+        {
+            cursor.writeSequenceCache = _writeSequence.load(std::memory_order_acquire);
+            if (cursor.writeSequenceCache == readSequence)
+            {
+                return nullptr;
+            }
+        }
+        return slot(readSequence);
+    }
+
+    void pop(const size_t consumer) noexcept
+    {
+        assert(consumer < _numConsumers);
+        Cursor& cursor = _cursors[consumer];
+        const uint64_t readSequence = cursor.readSequence.load(std::memory_order_relaxed);
+        assert(_writeSequence.load(std::memory_order_acquire) != readSequence
+               && "Call pop() only after front() returns a valid pointer");
+        // The slot is destroyed by the producer when it is reused, consumers only release it
+        cursor.readSequence.store(readSequence + 1, std::memory_order_release);
+    }
+
+    // Number of elements the consumer has not read yet
+    size_t size(const size_t consumer) const noexcept
+    {
+        assert(consumer < _numConsumers);
+        const uint64_t readSequence = _cursors[consumer].readSequence.load(std::memory_order_acquire);
+        return static_cast<size_t>(_writeSequence.load(std::memory_order_acquire) - readSequence);
+    }
+
+    bool empty(const size_t consumer) const noexcept { return size(consumer) == 0; }
+
+    // Sequence number of the element returned by front(consumer)
+    uint64_t readSequence(const size_t consumer) const noexcept
+    {
+        assert(consumer < _numConsumers);
+        return _cursors[consumer].readSequence.load(std::memory_order_acquire);
+    }
+
+    uint64_t writeSequence() const noexcept { return _writeSequence.load(std::memory_order_acquire); }
+
+    size_t capacity() const noexcept { return _capacity; }
+
+    size_t consumers() const noexcept { return _numConsumers; }
+};
@@ -4,9 +4,21 @@
 // -----------
 // SPSCQueue defines a single producer single consumer lock free queue. The implementation is
 // inspired by https://github.com/rigtorp/SPSCQueue.
+//
+// By default indices wrap by compare-and-reset against the capacity and one slot is kept as slack.
+// Setting PowerOfTwo rounds the capacity up to a power of two and uses free running 64 bit counters
+// which are masked into the slot array. The counters never wrap in practice, so size() is a plain
+// difference and readSequence()/writeSequence() can be used as message sequence numbers.
+//
+// Setting EnableTelemetry keeps counters of full stalls, try_emplace failures, empty polls and the
+// occupancy high water mark. Each counter is only written by the side that owns it and lives on that
+// side's cache line, so telemetry() can be called from any thread. When disabled the counters take no
+// space and no instructions. The occupancy is sampled rather than measured on every push, as reading
+// the consumer's index pulls its cache line over to the producer.
 
 #include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <iostream>
 #include <memory>  // std::allocator
 #include <new>     // std::hardware_destructive_interference_size
@@ -14,9 +26,47 @@
 #include <type_traits>  // std::enable_if, std::is_*_constructible
 #include <vector>
 
-template <typename T, typename Allocator = std::allocator<T>>
+struct SPSCQueueTelemetry
+{
+    // Number of emplace calls that had to spin because the queue was full
+    uint64_t fullStalls;
+    // Total number of spins across all full stalls
+    uint64_t fullSpins;
+    uint64_t tryEmplaceFailures;
+    // Number of front calls that found the queue empty
+    uint64_t emptyPolls;
+    size_t highWaterMark;
+};
+
+template <typename T, typename Allocator = std::allocator<T>, bool PowerOfTwo = false, bool EnableTelemetry = false>
 class SPSCQueue
 {
+    using IndexT = std::conditional_t<PowerOfTwo, uint64_t, size_t>;
+
+    // Counters are single writer so a relaxed load and store is enough, no read-modify-write is needed
+    static void bump(std::atomic<uint64_t>& counter, const uint64_t n = 1) noexcept
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    struct ProducerCounters
+    {
+        std::atomic<uint64_t> fullStalls{0};
+        std::atomic<uint64_t> fullSpins{0};
+        std::atomic<uint64_t> tryEmplaceFailures{0};
+        std::atomic<uint64_t> highWaterMark{0};
+        // Pushes left before the occupancy is next sampled, only used by the producer
+        uint32_t untilSample = 0;
+    };
+
+    struct ConsumerCounters
+    {
+        std::atomic<uint64_t> emptyPolls{0};
+    };
+
+    struct NoCounters
+    {};
+
 #if defined(__cpp_if_constexpr) && defined(__cpp_lib_void_t)
     template <typename Alloc2, typename = void>
     struct has_allocate_at_least : std::false_type
@@ -46,32 +96,125 @@ class SPSCQueue
     static constexpr size_t _padding = (_cacheLineSize - 1) / sizeof(T) + 1;
 
     size_t _capacity;
+    // Only used in power of two mode
+    size_t _mask;
     T* _slots;
 
     // Align to cache line size in order to avoid false sharing.
-    alignas(_cacheLineSize) std::atomic<size_t> _writeIndex{0};
-    alignas(_cacheLineSize) std::atomic<size_t> _readIndex{0};
+    alignas(_cacheLineSize) std::atomic<IndexT> _writeIndex{0};
+    alignas(_cacheLineSize) std::atomic<IndexT> _readIndex{0};
     // Use to reduce the amount of cache coherenecy traffic
-    alignas(_cacheLineSize) size_t _writeIndexCache{0};
-    alignas(_cacheLineSize) size_t _readIndexCache{0};
+    // Telemetry counters share the cache line of the side that writes them
+    alignas(_cacheLineSize) IndexT _writeIndexCache{0};
+#if defined(__has_cpp_attribute) && __has_cpp_attribute(no_unique_address)
+    std::conditional_t<EnableTelemetry, ConsumerCounters, NoCounters> _consumerCounters [[no_unique_address]];
+#else
+    std::conditional_t<EnableTelemetry, ConsumerCounters, NoCounters> _consumerCounters;
+#endif
+    alignas(_cacheLineSize) IndexT _readIndexCache{0};
+#if defined(__has_cpp_attribute) && __has_cpp_attribute(no_unique_address)
+    std::conditional_t<EnableTelemetry, ProducerCounters, NoCounters> _producerCounters [[no_unique_address]];
+#else
+    std::conditional_t<EnableTelemetry, ProducerCounters, NoCounters> _producerCounters;
+#endif
+
+    static size_t roundUpToPowerOfTwo(const size_t n)
+    {
+        size_t result = 1;
+        while (result < n)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    static constexpr uint32_t _occupancySamplePeriod = 64;
+
+    void recordHighWaterMark(const size_t occupancy) noexcept
+    {
+        if (occupancy > _producerCounters.highWaterMark.load(std::memory_order_relaxed))
+        {
+            _producerCounters.highWaterMark.store(occupancy, std::memory_order_relaxed);
+        }
+    }
+
+    // Called by the producer after publishing up to nextWriteIndex. The occupancy is computed from the
+    // cached read index, which is only exact right after a refresh, so it is taken when the push already
+    // refreshed the cache and otherwise every _occupancySamplePeriod pushes, refreshing the cache then.
+    void recordOccupancy(const IndexT nextWriteIndex, const bool refreshed) noexcept
+    {
+        if constexpr (EnableTelemetry)
+        {
+            if (!refreshed)
+            {
+                if (_producerCounters.untilSample > 0)
+                {
+                    --_producerCounters.untilSample;
+                    return;
+                }
+                _readIndexCache = _readIndex.load(std::memory_order_acquire);
+            }
+            _producerCounters.untilSample = _occupancySamplePeriod - 1;
+            if constexpr (PowerOfTwo)
+            {
+                recordHighWaterMark(static_cast<size_t>(nextWriteIndex - _readIndexCache));
+            }
+            else
+            {
+                recordHighWaterMark(nextWriteIndex >= _readIndexCache ? nextWriteIndex - _readIndexCache
+                                                                      : nextWriteIndex + _capacity - _readIndexCache);
+            }
+        }
+    }
+
+    void recordFullSpins(const uint64_t spins) noexcept
+    {
+        if constexpr (EnableTelemetry)
+        {
+            if (spins > 0)
+            {
+                bump(_producerCounters.fullStalls);
+                bump(_producerCounters.fullSpins, spins);
+            }
+        }
+    }
 
 public:
-    explicit SPSCQueue(const size_t capacity) : _capacity(capacity)
+    explicit SPSCQueue(const size_t capacity, const Allocator& allocator = Allocator())
+        : _allocator(allocator), _capacity(capacity), _mask(0)
     {
         if (_capacity < 1)
         {
             _capacity = 1;
         }
-        // Add one for slack
-        _capacity++;
-        // Prevent overflowing size_t
-        if (_capacity > SIZE_MAX - 2 * _padding)
+        if constexpr (PowerOfTwo)
         {
-            _capacity = SIZE_MAX - 2 * _padding;
+            // No slack is needed since full and empty are distinguished by the counter difference
+            if (_capacity > (SIZE_MAX >> 1) - 2 * _padding)
+            {
+                throw std::length_error("SPSCQueue capacity too large");
+            }
+            _capacity = roundUpToPowerOfTwo(_capacity);
+            _mask = _capacity - 1;
+        }
+        else
+        {
+            // Add one for slack
+            _capacity++;
+            // Prevent overflowing size_t
+            if (_capacity > SIZE_MAX - 2 * _padding)
+            {
+                _capacity = SIZE_MAX - 2 * _padding;
+            }
         }
 
 #if defined(__cpp_if_constexpr) && defined(__cpp_lib_void_t)
-        if constexpr (has_allocate_at_least<Allocator>::value)
+        if constexpr (PowerOfTwo)
+        {
+            // Any extra slots returned by allocate_at_least would break the mask, so ask for exactly what we need
+            _slots = std::allocator_traits<Allocator>::allocate(_allocator, _capacity + 2 * _padding);
+        }
+        else if constexpr (has_allocate_at_least<Allocator>::value)
         {
             auto res = _allocator.allocate_at_least(_capacity + 2 * _padding);
             _slots = res.ptr;
@@ -85,8 +228,8 @@ public:
         _slots = std::allocator_traits<Allocator>::allocate(_allocator, _capacity + 2 * _padding);
 #endif
 
-        static_assert(alignof(SPSCQueue<T>) == _cacheLineSize);
-        static_assert(sizeof(SPSCQueue<T>) >= 3 * _cacheLineSize);
+        static_assert(alignof(SPSCQueue) == _cacheLineSize);
+        static_assert(sizeof(SPSCQueue) >= 3 * _cacheLineSize);
         assert(reinterpret_cast<char*>(&_readIndex) - reinterpret_cast<char*>(&_writeIndex)
                >= static_cast<std::ptrdiff_t>(_cacheLineSize));
     }
@@ -97,6 +240,7 @@ public:
         {
             pop();
         }
+        std::allocator_traits<Allocator>::deallocate(_allocator, _slots, _capacity + 2 * _padding);
     }
 
     SPSCQueue(const SPSCQueue&) = delete;
@@ -106,20 +250,51 @@ public:
     void emplace(Args&&... args)
     {
         static_assert(std::is_constructible<T, Args&&...>::value, "T is not constructible with Args");
-        const size_t writeIndex = _writeIndex.load(std::memory_order_relaxed);
-        size_t nextWriteIndex = writeIndex + 1;
-        if (nextWriteIndex == _capacity)
+        const IndexT writeIndex = _writeIndex.load(std::memory_order_relaxed);
+        if constexpr (PowerOfTwo)
         {
-            nextWriteIndex = 0;
-        }
+            uint64_t spins = 0;
+            bool refreshed = false;
+            while (writeIndex - _readIndexCache == _capacity)
+            {
+                _readIndexCache = _readIndex.load(std::memory_order_acquire);
+                refreshed = true;
+                if constexpr (EnableTelemetry)
+                {
+                    spins += writeIndex - _readIndexCache == _capacity;
+                }
+            }
+            recordFullSpins(spins);
 
-        while (nextWriteIndex == _readIndexCache)
-        {
-            _readIndexCache = _readIndex.load(std::memory_order_acquire);
+            new (&_slots[(writeIndex & _mask) + _padding]) T(std::forward<Args>(args)...);
+            _writeIndex.store(writeIndex + 1, std::memory_order_release);
+            recordOccupancy(writeIndex + 1, refreshed);
         }
+        else
+        {
+            IndexT nextWriteIndex = writeIndex + 1;
+            if (nextWriteIndex == _capacity)
+            {
+                nextWriteIndex = 0;
+            }
 
-        new (&_slots[writeIndex + _padding]) T(std::forward<Args>(args)...);
-        _writeIndex.store(nextWriteIndex, std::memory_order_release);
+            uint64_t spins = 0;
+            bool refreshed = false;
+            while (nextWriteIndex == _readIndexCache)
+            {
+                _readIndexCache = _readIndex.load(std::memory_order_acquire);
+                refreshed = true;
+                if constexpr (EnableTelemetry)
+                {
+                    spins += nextWriteIndex == _readIndexCache;
+                }
+            }
+            recordFullSpins(spins);
+
+            new (&_slots[writeIndex + _padding]) T(std::forward<Args>(args)...);
+            _writeIndex.store(nextWriteIndex, std::memory_order_release);
+            recordOccupancy(nextWriteIndex, refreshed);
+        }
     }
 
     template <typename... Args>
@@ -127,21 +302,52 @@ public:
     {
         static_assert(std::is_constructible<T, Args&&...>::value, "T is not constructible with Args");
         const auto writeIndex = _writeIndex.load(std::memory_order_relaxed);
-        auto nextWriteIndex = writeIndex + 1;
-        if (nextWriteIndex == _capacity)
+        bool refreshed = false;
+        if constexpr (PowerOfTwo)
         {
-            nextWriteIndex = 0;
+            if (writeIndex - _readIndexCache == _capacity)
+            {
+                refreshed = true;
+                _readIndexCache = _readIndex.load(std::memory_order_acquire);
+                if (writeIndex - _readIndexCache == _capacity)
+                {
+                    if constexpr (EnableTelemetry)
+                    {
+                        bump(_producerCounters.tryEmplaceFailures);
+                        recordHighWaterMark(capacity());
+                    }
+                    return false;
+                }
+            }
+            new (&_slots[(writeIndex & _mask) + _padding]) T(std::forward<Args>(args)...);
+            _writeIndex.store(writeIndex + 1, std::memory_order_release);
+            recordOccupancy(writeIndex + 1, refreshed);
         }
-        if (nextWriteIndex == _readIndexCache)
+        else
         {
-            _readIndexCache = _readIndex.load(std::memory_order_acquire);
+            auto nextWriteIndex = writeIndex + 1;
+            if (nextWriteIndex == _capacity)
+            {
+                nextWriteIndex = 0;
+            }
             if (nextWriteIndex == _readIndexCache)
             {
-                return false;
+                refreshed = true;
+                _readIndexCache = _readIndex.load(std::memory_order_acquire);
+                if (nextWriteIndex == _readIndexCache)
+                {
+                    if constexpr (EnableTelemetry)
+                    {
+                        bump(_producerCounters.tryEmplaceFailures);
+                        recordHighWaterMark(capacity());
+                    }
+                    return false;
+                }
             }
+            new (&_slots[writeIndex + _padding]) T(std::forward<Args>(args)...);
+            _writeIndex.store(nextWriteIndex, std::memory_order_release);
+            recordOccupancy(nextWriteIndex, refreshed);
         }
-        new (&_slots[writeIndex + _padding]) T(std::forward<Args>(args)...);
-        _writeIndex.store(nextWriteIndex, std::memory_order_release);
         return true;
     }
 
@@ -171,10 +377,21 @@ public:
             _writeIndexCache = _writeIndex.load(std::memory_order_acquire);
             if (_writeIndexCache == readIndex)
             {
+                if constexpr (EnableTelemetry)
+                {
+                    bump(_consumerCounters.emptyPolls);
+                }
                 return nullptr;
             }
         }
-        return &_slots[readIndex + _padding];
+        if constexpr (PowerOfTwo)
+        {
+            return &_slots[(readIndex & _mask) + _padding];
+        }
+        else
+        {
+            return &_slots[readIndex + _padding];
+        }
     }
 
     void pop() noexcept
@@ -183,23 +400,41 @@ public:
         const auto readIndex = _readIndex.load(std::memory_order_relaxed);
         assert(_writeIndex.load(std::memory_order_acquire) != readIndex
                && "Call pop() only after front() returns a valid pointer");
-        _slots[readIndex + _padding].~T();
-        auto nextReadIndex = readIndex + 1;
-        if (nextReadIndex == _capacity)
+        if constexpr (PowerOfTwo)
+        {
+            _slots[(readIndex & _mask) + _padding].~T();
+            _readIndex.store(readIndex + 1, std::memory_order_release);
+        }
+        else
         {
-            nextReadIndex = 0;
+            _slots[readIndex + _padding].~T();
+            auto nextReadIndex = readIndex + 1;
+            if (nextReadIndex == _capacity)
+            {
+                nextReadIndex = 0;
+            }
+            _readIndex.store(nextReadIndex, std::memory_order_release);
         }
-        _readIndex.store(nextReadIndex, std::memory_order_release);
     }
 
     size_t size() const noexcept
     {
-        std::ptrdiff_t diff = _writeIndex.load(std::memory_order_acquire) - _readIndex.load(std::memory_order_acquire);
-        if (diff < 0)
+        if constexpr (PowerOfTwo)
+        {
+            // Load the read index first so the write index can never be behind it
+            const IndexT readIndex = _readIndex.load(std::memory_order_acquire);
+            return static_cast<size_t>(_writeIndex.load(std::memory_order_acquire) - readIndex);
+        }
+        else
         {
-            diff += _capacity;
+            std::ptrdiff_t diff =
+                _writeIndex.load(std::memory_order_acquire) - _readIndex.load(std::memory_order_acquire);
+            if (diff < 0)
+            {
+                diff += _capacity;
+            }
+            return static_cast<size_t>(diff);
         }
-        return static_cast<size_t>(diff);
     }
 
     bool empty() const noexcept
@@ -207,5 +442,43 @@ public:
         return _writeIndex.load(std::memory_order_acquire) == _readIndex.load(std::memory_order_acquire);
     }
 
-    size_t capacity() const noexcept { return _capacity - 1; }
+    size_t capacity() const noexcept
+    {
+        if constexpr (PowerOfTwo)
+        {
+            return _capacity;
+        }
+        else
+        {
+            return _capacity - 1;
+        }
+    }
+
+    // Number of elements ever pushed. Only available in power of two mode.
+    uint64_t writeSequence() const noexcept
+    {
+        static_assert(PowerOfTwo, "Sequence numbers require PowerOfTwo mode");
+        return _writeIndex.load(std::memory_order_acquire);
+    }
+
+    // Number of elements ever popped, i.e. the sequence number of front(). Only available in power of two mode.
+    uint64_t readSequence() const noexcept
+    {
+        static_assert(PowerOfTwo, "Sequence numbers require PowerOfTwo mode");
+        return _readIndex.load(std::memory_order_acquire);
+    }
+
+    // Snapshot of the counters. Safe to call from any thread, each counter is individually consistent.
+    SPSCQueueTelemetry telemetry() const noexcept
+    {
+        static_assert(EnableTelemetry, "Telemetry requires EnableTelemetry");
+        return {_producerCounters.fullStalls.load(std::memory_order_relaxed),
+                _producerCounters.fullSpins.load(std::memory_order_relaxed),
+                _producerCounters.tryEmplaceFailures.load(std::memory_order_relaxed),
+                _consumerCounters.emptyPolls.load(std::memory_order_relaxed),
+                static_cast<size_t>(_producerCounters.highWaterMark.load(std::memory_order_relaxed))};
+    }
 };
+
+template <typename T, typename Allocator = std::allocator<T>>
+using PowerOfTwoSPSCQueue = SPSCQueue<T, Allocator, true>;
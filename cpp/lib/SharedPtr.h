@@ -1,53 +1,209 @@
 #pragma once
 
+// SharedPtr.h
+// -----------
+// Reference counted pointer. How the count is updated is chosen by the RefCountPolicy, see RefCount.h.
+//
+// The count lives in a control block. makeShared places the object inside the control block, so it
+// costs one allocation and the count shares a cache line with the start of the object. Adopting a raw
+// pointer allocates a separate control block that deletes the pointer. The block type is erased behind
+// a virtual destroy() that only runs when the last reference goes away.
+//
+// allocateShared does the same as makeShared with the block taken from a standard allocator, such as
+// HugePageAllocator over a per-thread arena, and the adopting constructors accept a custom deleter and
+// an allocator for the block. The deleter and allocator are stored in the block and erased along with
+// it, so they do not change the type of the SharedPtr and the last release hands the memory back to
+// where it came from.
+
+#include <memory>  // std::allocator, std::allocator_traits, std::default_delete
+#include <new>     // std::launder
+#include <type_traits>
 #include <utility>
 
-template <typename T>
+#include "lib/RefCount.h"
+
+template <typename T, typename RefCountPolicy = NonAtomicRefCount>
+class SharedPtr;
+
+template <typename T, typename RefCountPolicy = NonAtomicRefCount, typename Allocator, typename... Args>
+SharedPtr<T, RefCountPolicy> allocateShared(const Allocator& allocator, Args&&... args);
+
+template <typename T, typename RefCountPolicy>
 class SharedPtr
 {
+    template <typename U, typename P, typename A, typename... Args>
+    friend SharedPtr<U, P> allocateShared(const A& allocator, Args&&... args);
+
+    using Count = typename RefCountPolicy::Count;
+
+    struct ControlBlock
+    {
+        Count refCount{1};
+
+        virtual ~ControlBlock() = default;
+
+        // Destroy the object and free the block
+        virtual void destroy() noexcept = 0;
+    };
+
+    // Free a block through the allocator copy stored inside it. The block keeps the allocator as given
+    // and only rebinds it here, where the block type is complete.
+    template <typename Block>
+    static void deallocate(Block* const block) noexcept
+    {
+        typename Block::BlockAllocator allocator(block->allocator);
+        block->~Block();
+        std::allocator_traits<typename Block::BlockAllocator>::deallocate(allocator, block, 1);
+    }
+
+    template <typename Block, typename Allocator, typename... Args>
+    static Block* createBlock(const Allocator& allocator, Args&&... args)
+    {
+        typename Block::BlockAllocator blockAllocator(allocator);
+        Block* const block = std::allocator_traits<typename Block::BlockAllocator>::allocate(blockAllocator, 1);
+        try
+        {
+            new (block) Block(allocator, std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            std::allocator_traits<typename Block::BlockAllocator>::deallocate(blockAllocator, block, 1);
+            throw;
+        }
+        return block;
+    }
+
+    // Control block for an adopted pointer
+    template <typename Deleter, typename Allocator>
+    struct PointerBlock final : ControlBlock
+    {
+        using BlockAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<PointerBlock>;
+
+        T* ptr;
+#if defined(__has_cpp_attribute) && __has_cpp_attribute(no_unique_address)
+        Deleter deleter [[no_unique_address]];
+        Allocator allocator [[no_unique_address]];
+#else
+        Deleter deleter;
+        Allocator allocator;
+#endif
+
+        PointerBlock(const Allocator& allocator, T* const ptr, Deleter deleter)
+            : ptr(ptr), deleter(std::move(deleter)), allocator(allocator)
+        {}
+
+        void destroy() noexcept override
+        {
+            deleter(ptr);
+            deallocate(this);
+        }
+    };
+
+    // Control block holding the object itself
+    template <typename Allocator>
+    struct InplaceBlock final : ControlBlock
+    {
+        using BlockAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<InplaceBlock>;
+
+#if defined(__has_cpp_attribute) && __has_cpp_attribute(no_unique_address)
+        Allocator allocator [[no_unique_address]];
+#else
+        Allocator allocator;
+#endif
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        template <typename... Args>
+        explicit InplaceBlock(const Allocator& allocator, Args&&... args) : allocator(allocator)
+        {
+            new (storage) T(std::forward<Args>(args)...);
+        }
+
+        T* get() noexcept { return std::launder(reinterpret_cast<T*>(storage)); }
+
+        void destroy() noexcept override
+        {
+            get()->~T();
+            deallocate(this);
+        }
+    };
+
     T* ptr;
-    int* refCount;
+    ControlBlock* block;
+
+    SharedPtr(ControlBlock* const block, T* const ptr) : ptr(ptr), block(block) {}
 
     void reset()
     {
-        if (refCount && --(*refCount) == 0)
+        if (block && RefCountPolicy::decrement(block->refCount))
         {
-            delete ptr;
-            delete refCount;
+            block->destroy();
         }
     }
 
 public:
-    SharedPtr() : ptr(nullptr), refCount(nullptr) {}
+    SharedPtr() : ptr(nullptr), block(nullptr) {}
+
+    SharedPtr(T* const ptr) : SharedPtr(ptr, std::default_delete<T>()) {}
 
-    SharedPtr(T* const ptr) : ptr(ptr), refCount(new int(1)) {}
+    // The deleter is called with ptr on the last release, and also if allocating the block throws
+    template <typename Deleter>
+    SharedPtr(T* const ptr, Deleter deleter)
+        : SharedPtr(ptr, std::move(deleter), std::allocator<std::remove_cv_t<T>>())
+    {}
+
+    template <typename Deleter, typename Allocator>
+    SharedPtr(T* const ptr, Deleter deleter, const Allocator& allocator) : ptr(ptr), block(nullptr)
+    {
+        try
+        {
+            block = createBlock<PointerBlock<Deleter, Allocator>>(allocator, ptr, deleter);
+        }
+        catch (...)
+        {
+            deleter(ptr);
+            throw;
+        }
+    }
 
-    SharedPtr(const SharedPtr& other) : ptr(other.ptr), refCount(other.refCount) { (*refCount)++; }
+    SharedPtr(const SharedPtr& other) : ptr(other.ptr), block(other.block)
+    {
+        if (block)
+        {
+            RefCountPolicy::increment(block->refCount);
+        }
+    }
 
-    SharedPtr(SharedPtr<T>&& other) : ptr(other.ptr), refCount(other.refCount)
+    SharedPtr(SharedPtr&& other) : ptr(other.ptr), block(other.block)
     {
         other.ptr = nullptr;
-        other.refCount = nullptr;
+        other.block = nullptr;
     }
 
     ~SharedPtr() { reset(); }
 
     SharedPtr& operator=(const SharedPtr& other)
     {
+        // Take the new reference first so that self assignment cannot drop the last one
+        if (other.block)
+        {
+            RefCountPolicy::increment(other.block->refCount);
+        }
         reset();
-        (*other.refCount)++;
         ptr = other.ptr;
-        refCount = other.refCount;
+        block = other.block;
         return *this;
     }
 
     SharedPtr& operator=(SharedPtr&& other)
     {
-        reset();
-        ptr = other.ptr;
-        refCount = other.refCount;
-        other.ptr = nullptr;
-        refCount = nullptr;
+        if (this != &other)
+        {
+            reset();
+            ptr = other.ptr;
+            block = other.block;
+            other.ptr = nullptr;
+            other.block = nullptr;
+        }
         return *this;
     }
 
@@ -56,10 +212,22 @@ public:
     T* operator->() const { return ptr; }
 
     T* get() const { return ptr; }
+
+    // Number of SharedPtr sharing the object, 0 when empty. Only a hint with AtomicRefCount.
+    long useCount() const { return block ? RefCountPolicy::load(block->refCount) : 0; }
 };
 
-template <typename T, typename... Args>
-SharedPtr<T> makeShared(Args&&... args)
+template <typename T, typename RefCountPolicy, typename Allocator, typename... Args>
+SharedPtr<T, RefCountPolicy> allocateShared(const Allocator& allocator, Args&&... args)
+{
+    using Ptr = SharedPtr<T, RefCountPolicy>;
+    using Block = typename Ptr::template InplaceBlock<Allocator>;
+    Block* const block = Ptr::template createBlock<Block>(allocator, std::forward<Args>(args)...);
+    return Ptr(block, block->get());
+}
+
+template <typename T, typename RefCountPolicy = NonAtomicRefCount, typename... Args>
+SharedPtr<T, RefCountPolicy> makeShared(Args&&... args)
 {
-    return SharedPtr(new T(std::forward<Args>(args)...));
+    return allocateShared<T, RefCountPolicy>(std::allocator<std::remove_cv_t<T>>(), std::forward<Args>(args)...);
 }
@@ -1,6 +1,8 @@
 #pragma once
 
-enum class Side
+#include <cstdint>
+
+enum class Side : uint8_t
 {
     BID,
     ASK
@@ -0,0 +1,292 @@
+#pragma once
+
+// SimdLinearProbingHashSet.h
+// --------------------------
+// Variant of LinearProbingHashSet in the style of a Swiss table. A separate array of one byte control
+// tags marks each slot as empty, deleted or full, and full slots keep 7 bits of the hash. Lookups
+// compare a group of 16 tags at once with SSE2 and only touch the slots whose tag matches, so even long
+// probe chains at high load factors mostly stay within the control bytes.
+//
+// Groups are probed linearly. The first group of tags is mirrored after the end of the array so a
+// group starting near the end can be loaded with a single unaligned load. Removal leaves a deleted tag
+// behind, tombstones are cleared by the next rehash.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>  // std::allocator
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+template <typename T>
+class SimdLinearProbingHashSet
+{
+    using CtrlT = int8_t;
+
+    static constexpr size_t _groupWidth = 16;
+    static constexpr size_t _minCapacity = _groupWidth;
+    // Empty and deleted both have the sign bit set, full tags are the 7 low hash bits
+    static constexpr CtrlT _emptyTag = -128;
+    static constexpr CtrlT _deletedTag = -2;
+
+    // Bit i is set when tag i of the group matches
+    class Group
+    {
+#ifdef __SSE2__
+        __m128i _ctrl;
+
+    public:
+        explicit Group(const CtrlT* ctrl) : _ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))) {}
+
+        uint32_t match(const CtrlT tag) const
+        {
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_ctrl, _mm_set1_epi8(tag))));
+        }
+
+        uint32_t matchEmptyOrDeleted() const { return static_cast<uint32_t>(_mm_movemask_epi8(_ctrl)); }
+#else
+        CtrlT _ctrl[_groupWidth];
+
+    public:
+        explicit Group(const CtrlT* ctrl) { std::memcpy(_ctrl, ctrl, _groupWidth); }
+
+        uint32_t match(const CtrlT tag) const
+        {
+            uint32_t mask = 0;
+            for (size_t i = 0; i < _groupWidth; ++i)
+            {
+                mask |= static_cast<uint32_t>(_ctrl[i] == tag) << i;
+            }
+            return mask;
+        }
+
+        uint32_t matchEmptyOrDeleted() const
+        {
+            uint32_t mask = 0;
+            for (size_t i = 0; i < _groupWidth; ++i)
+            {
+                mask |= static_cast<uint32_t>(_ctrl[i] < 0) << i;
+            }
+            return mask;
+        }
+#endif
+
+        uint32_t matchEmpty() const { return match(_emptyTag); }
+    };
+
+    size_t _size;
+    size_t _deleted;
+    size_t _capacity;
+    float _maxLoadFactor;
+    std::hash<T> _hasher;
+    std::allocator<T> _allocator;
+    // _capacity tags followed by a mirror of the first _groupWidth tags
+    std::vector<CtrlT> _ctrl;
+    T* _slots;
+
+    static size_t roundUpToPowerOfTwo(const size_t n)
+    {
+        size_t result = 1;
+        while (result < n)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    // std::hash is the identity for integers, mix it so both the home group and the tag get good bits
+    uint64_t getHash(const T& item) const
+    {
+        const uint64_t h = static_cast<uint64_t>(_hasher(item)) * 0x9E3779B97F4A7C15ULL;
+        return h ^ (h >> 32);
+    }
+
+    static CtrlT tag(const uint64_t hash) { return static_cast<CtrlT>(hash & 0x7F); }
+
+    size_t home(const uint64_t hash) const { return (hash >> 7) & (_capacity - 1); }
+
+    void setCtrl(const size_t i, const CtrlT value)
+    {
+        _ctrl[i] = value;
+        if (i < _groupWidth)
+        {
+            _ctrl[_capacity + i] = value;
+        }
+    }
+
+    size_t capacityFor(const size_t count) const
+    {
+        const size_t needed = static_cast<size_t>(std::ceil(static_cast<double>(count) / _maxLoadFactor));
+        return roundUpToPowerOfTwo(std::max(needed, _minCapacity));
+    }
+
+    // Index of the item or _capacity when absent
+    size_t find(const T& item, const uint64_t hash) const
+    {
+        const CtrlT itemTag = tag(hash);
+        size_t pos = home(hash);
+        while (true)
+        {
+            const Group group(&_ctrl[pos]);
+            for (uint32_t mask = group.match(itemTag); mask != 0; mask &= mask - 1)
+            {
+                const size_t i = (pos + __builtin_ctz(mask)) & (_capacity - 1);
+                if (_slots[i] == item)
+                {
+                    return i;
+                }
+            }
+            // The load factor guarantees an empty tag somewhere, which ends every probe sequence
+            if (group.matchEmpty() != 0)
+            {
+                return _capacity;
+            }
+            pos = (pos + _groupWidth) & (_capacity - 1);
+        }
+    }
+
+    // First empty or deleted slot of the probe sequence
+    size_t findFree(const uint64_t hash) const
+    {
+        size_t pos = home(hash);
+        while (true)
+        {
+            const uint32_t mask = Group(&_ctrl[pos]).matchEmptyOrDeleted();
+            if (mask != 0)
+            {
+                return (pos + __builtin_ctz(mask)) & (_capacity - 1);
+            }
+            pos = (pos + _groupWidth) & (_capacity - 1);
+        }
+    }
+
+    template <typename U>
+    void insertUnique(U&& item, const uint64_t hash)
+    {
+        const size_t i = findFree(hash);
+        if (_ctrl[i] == _deletedTag)
+        {
+            --_deleted;
+        }
+        setCtrl(i, tag(hash));
+        new (&_slots[i]) T(std::forward<U>(item));
+        ++_size;
+    }
+
+    void allocate(const size_t capacity)
+    {
+        _capacity = capacity;
+        _ctrl.assign(_capacity + _groupWidth, _emptyTag);
+        _slots = _allocator.allocate(_capacity);
+    }
+
+    void destroy()
+    {
+        for (size_t i = 0; i < _capacity; ++i)
+        {
+            if (_ctrl[i] >= 0)
+            {
+                _slots[i].~T();
+            }
+        }
+        _allocator.deallocate(_slots, _capacity);
+    }
+
+    void rehash(const size_t capacity)
+    {
+        const std::vector<CtrlT> oldCtrl = std::move(_ctrl);
+        T* const oldSlots = _slots;
+        const size_t oldCapacity = _capacity;
+
+        allocate(capacity);
+        _size = 0;
+        _deleted = 0;
+        for (size_t i = 0; i < oldCapacity; ++i)
+        {
+            if (oldCtrl[i] >= 0)
+            {
+                const uint64_t hash = getHash(oldSlots[i]);
+                insertUnique(std::move(oldSlots[i]), hash);
+                oldSlots[i].~T();
+            }
+        }
+        _allocator.deallocate(oldSlots, oldCapacity);
+    }
+
+public:
+    // The capacity is rounded up to a power of two of at least one group
+    SimdLinearProbingHashSet(const size_t capacity = _minCapacity, const float maxLoadFactor = 0.875f)
+        : _size(0), _deleted(0), _maxLoadFactor(maxLoadFactor)
+    {
+        if (!(_maxLoadFactor > 0.0f && _maxLoadFactor < 1.0f))
+        {
+            throw std::invalid_argument("Max load factor must be in (0, 1), " + std::to_string(_maxLoadFactor));
+        }
+        allocate(roundUpToPowerOfTwo(std::max(capacity, _minCapacity)));
+    }
+
+    ~SimdLinearProbingHashSet() { destroy(); }
+
+    SimdLinearProbingHashSet(const SimdLinearProbingHashSet&) = delete;
+    SimdLinearProbingHashSet& operator=(const SimdLinearProbingHashSet&) = delete;
+
+    bool insert(const T& item)
+    {
+        const uint64_t hash = getHash(item);
+        if (find(item, hash) != _capacity)
+        {
+            return false;
+        }
+        if (static_cast<double>(_size + _deleted + 1) > _capacity * static_cast<double>(_maxLoadFactor))
+        {
+            // Rehashing in place is enough when tombstones are what fills the table
+            rehash(std::max(_capacity, capacityFor(_size + 1)));
+        }
+        insertUnique(item, hash);
+        return true;
+    }
+
+    bool remove(const T& item)
+    {
+        const size_t i = find(item, getHash(item));
+        if (i == _capacity)
+        {
+            return false;
+        }
+        _slots[i].~T();
+        setCtrl(i, _deletedTag);
+        ++_deleted;
+        --_size;
+        return true;
+    }
+
+    bool contains(const T& item) const { return find(item, getHash(item)) != _capacity; }
+
+    size_t size() const { return _size; }
+
+    size_t capacity() const { return _capacity; }
+
+    float loadFactor() const { return static_cast<float>(_size) / _capacity; }
+
+    float maxLoadFactor() const { return _maxLoadFactor; }
+
+    void resize(const size_t capacity)
+    {
+        rehash(std::max(roundUpToPowerOfTwo(std::max(capacity, _minCapacity)), capacityFor(_size)));
+    }
+
+    void reserve(const size_t count)
+    {
+        const size_t capacity = capacityFor(count);
+        if (capacity > _capacity)
+        {
+            rehash(capacity);
+        }
+    }
+};
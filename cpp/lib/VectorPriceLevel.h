@@ -0,0 +1,118 @@
+#pragma once
+
+// VectorPriceLevel.h
+// ------------------
+// Price level keeping its orders in time priority as parallel arrays of oids and sizes, so matching
+// streams through the sizes four times as densely as through whole orders and only reads the oid of an
+// order it trades with. All containers allocate through Allocator, which is rebound as needed.
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>  // std::allocator, std::allocator_traits
+#include <vector>
+
+#include "lib/Fill.h"
+#include "lib/MatchKernel.h"
+#include "lib/Order.h"
+
+template <typename Allocator = std::allocator<Order>>
+class BasicVectorPriceLevel
+{
+    template <typename U>
+    using RebindAlloc = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+
+public:
+    using OidVector = std::vector<OrderIdT, RebindAlloc<OrderIdT>>;
+    using SizeVector = std::vector<SizeT, RebindAlloc<SizeT>>;
+    // Positions shift as orders ahead leave, so an order is found again by its oid
+    using Position = OrderIdT;
+    using Context = Allocator;
+
+private:
+    PriceT price;
+    OidVector oids;
+    SizeVector sizes;
+    // Sum of the resting sizes, kept up to date so depth is O(1)
+    uint64_t total = 0;
+
+public:
+    BasicVectorPriceLevel(const PriceT price, const Allocator& allocator = Allocator())
+        : price(price), oids(allocator), sizes(allocator)
+    {}
+
+    inline PriceT getPrice() const { return price; }
+
+    Position add(const Order& order)
+    {
+        oids.push_back(order.oid);
+        sizes.push_back(order.size);
+        total += order.size;
+        return order.oid;
+    }
+
+    // Match against the resting orders in time priority, appending a fill per order traded with. The
+    // kernel finds every order the incoming one sweeps in one pass over the sizes, then the fills are
+    // written and the filled prefix erased in bulk.
+    void match(Order& order, std::vector<Fill>& fills)
+    {
+        const SizeT quantity = order.size;
+        const MatchCutoff cutoff = matchCutoff(sizes.data(), sizes.size(), order.size);
+        size_t filled = cutoff.index;
+        const bool partial = filled < sizes.size();
+        // Written through raw pointers, as stores through push_back may alias the level's arrays and
+        // force them to be reloaded for every fill
+        const size_t first = fills.size();
+        fills.resize(first + filled);
+        Fill* const out = fills.data() + first;
+        const OrderIdT* const oid = oids.data();
+        const SizeT* const size = sizes.data();
+        for (size_t i = 0; i < filled; ++i)
+        {
+            out[i] = Fill{price, order.oid, oid[i], size[i], 0, true};
+        }
+        order.size -= static_cast<SizeT>(cutoff.before);
+        if (partial)
+        {
+            SizeT& resting = sizes[filled];
+            resting -= order.size;
+            fills.push_back(Fill{price, order.oid, oids[filled], order.size, resting, resting == 0});
+            order.size = 0;
+            if (resting == 0)
+            {
+                ++filled;
+            }
+        }
+        total -= quantity - order.size;
+        if (filled > 0)
+        {
+            oids.erase(oids.begin(), oids.begin() + filled);
+            sizes.erase(sizes.begin(), sizes.begin() + filled);
+        }
+    }
+
+    bool cancel(const Position oid)
+    {
+        const auto it = std::find(oids.begin(), oids.end(), oid);
+        if (it == oids.end())
+        {
+            return false;
+        }
+        const auto sizeIt = sizes.begin() + (it - oids.begin());
+        total -= *sizeIt;
+        sizes.erase(sizeIt);
+        oids.erase(it);
+        return true;
+    }
+
+    bool empty() const { return oids.empty(); }
+
+    size_t size() const { return oids.size(); }
+
+    uint64_t totalSize() const { return total; }
+
+    const OidVector& getOids() const { return oids; }
+
+    const SizeVector& getSizes() const { return sizes; }
+};
+
+using VectorPriceLevel = BasicVectorPriceLevel<>;
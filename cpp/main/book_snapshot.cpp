@@ -0,0 +1,62 @@
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+
+#include "lib/AtomicSharedPtr.h"
+#include "lib/BookSnapshot.h"
+#include "lib/MapOrderBook.h"
+
+int main()
+{
+    // The matching thread owns the book and publishes the top 5 levels every 100 orders, a risk thread
+    // reads whatever snapshot is current without ever touching the book
+    AtomicSharedPtr<const BookSnapshot> published;
+    std::atomic<bool> done{false};
+
+    std::thread risk(
+        [&]
+        {
+            uint64_t lastSequence = 0;
+            while (!done.load(std::memory_order_acquire))
+            {
+                const auto snapshot = published.load();
+                if (snapshot.get() && snapshot->sequence != lastSequence)
+                {
+                    lastSequence = snapshot->sequence;
+                    const DepthLevel* bid = snapshot->bestBid();
+                    const DepthLevel* ask = snapshot->bestAsk();
+                    std::cout << "Snapshot " << snapshot->sequence << ": ";
+                    if (bid)
+                    {
+                        std::cout << bid->size << " @ $" << bid->price;
+                    }
+                    std::cout << " / ";
+                    if (ask)
+                    {
+                        std::cout << ask->size << " @ $" << ask->price;
+                    }
+                    std::cout << std::endl;
+                }
+                std::this_thread::yield();
+            }
+        });
+
+    MapOrderBook book;
+    for (OrderIdT oid = 1; oid <= 1000; ++oid)
+    {
+        // Resting bids below 100 and asks above it, with the odd order crossing the spread
+        const bool bid = oid % 2 == 0;
+        const PriceT offset = static_cast<PriceT>(oid % 7) - (oid % 11 == 0 ? 3 : 0);
+        book.add(oid, bid ? "B" : "A", bid ? 99 - offset : 101 + offset, static_cast<SizeT>(oid % 50 + 1));
+        if (oid % 100 == 0)
+        {
+            BookSnapshot snapshot = book.snapshot(5);
+            snapshot.sequence = oid;
+            published.store(makeShared<const BookSnapshot, AtomicRefCount>(std::move(snapshot)));
+        }
+    }
+
+    done.store(true, std::memory_order_release);
+    risk.join();
+}
@@ -1,5 +1,4 @@
 #include <iostream>
-#include <numeric>
 
 #include "lib/MapOrderBook.h"
 
@@ -16,18 +15,12 @@ int main()
     const auto& asks = book.getAsks();
     for (auto it = asks.crbegin(); it != asks.crend(); ++it)
     {
-        const auto& orders = it->second.getOrders();
-        const size_t size =
-            std::accumulate(orders.begin(), orders.end(), 0, [](size_t curr, const Order& o) { return curr + o.size; });
-        std::cout << "Ask $" << it->first << " for " << size << std::endl;
+        std::cout << "Ask $" << it->first << " for " << it->second.totalSize() << std::endl;
     }
 
     const auto& bids = book.getBids();
     for (const auto& [price, level] : bids)
     {
-        const auto& orders = level.getOrders();
-        const size_t size =
-            std::accumulate(orders.begin(), orders.end(), 0, [](size_t curr, const Order& o) { return curr + o.size; });
-        std::cout << "Bid $" << price << " for " << size << std::endl;
+        std::cout << "Bid $" << price << " for " << level.totalSize() << std::endl;
     }
 }
\ No newline at end of file
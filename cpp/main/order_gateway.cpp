@@ -0,0 +1,598 @@
+// order_gateway.cpp
+// -----------------
+// Order gateway pipeline. A parser thread decodes a binary order stream into Order records and hands
+// them through an SPSCQueue to a matching thread that owns a MapOrderBook. Fills and changes of the
+// best bid and offer go through a second SPSCQueue to a publisher thread that encodes them to the
+// output. Every request is stamped when it is decoded and the publisher measures the end to end
+// latency of each event from that stamp, so replaying a file faster than the book matches also counts
+// the time requests wait in the queue. Per stage throughput, latency percentiles and queue
+// telemetry are written to stderr.
+//
+// Malformed input, a rejected request such as a duplicate oid, or a failed write stops the stage it
+// happens in. That stage still passes the end marker downstream and flags that it stopped, so the stage
+// feeding it stops rather than blocking on a full queue. Every thread is joined and the first error is
+// reported with a non zero exit status.
+//
+// Input records are 16 bytes: type 'A' (add) or 'X' (cancel), side 'B' or 'A', size u16, oid u32 and
+// price f64, which must be finite, and an add must have a non zero size. Output records are 24 byte
+// fills: 'F', pad, size u16, aggressor oid u32, passive oid u32, pad u32, price f64; and 32 byte depth
+// updates: 'D', pad[3], bid size u32, ask size u32, pad u32, bid price f64, ask price f64. A side with
+// no orders has size 0 and price 0. All fields are in host byte order.
+//
+// Usage: order_gateway --input FILE [--output FILE] [--queue-capacity N]
+//        order_gateway --generate N --input FILE
+// FILE may be - for stdin or stdout.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lib/MapOrderBook.h"
+#include "lib/SPSCQueue.h"
+
+namespace
+{
+
+constexpr size_t requestSize = 16;
+constexpr size_t fillSize = 24;
+constexpr size_t depthSize = 32;
+
+struct Config
+{
+    std::string input;
+    std::string output = "-";
+    size_t queueCapacity = 1 << 16;
+    uint64_t generate = 0;
+};
+
+struct Request
+{
+    enum class Type : uint8_t
+    {
+        Add,
+        Cancel,
+        End
+    };
+
+    Type type;
+    Order order;
+    uint64_t ingestNs;
+};
+
+struct Event
+{
+    enum class Type : uint8_t
+    {
+        Fill,
+        Depth,
+        End
+    };
+
+    Type type;
+    uint64_t ingestNs;
+    // Fill
+    OrderIdT aggressor;
+    OrderIdT passive;
+    PriceT price;
+    SizeT size;
+    // Depth
+    DepthLevel bid;
+    DepthLevel ask;
+};
+
+// Power of two mode for the masked indices, telemetry to report how often each stage waited
+template <typename T>
+using Queue = SPSCQueue<T, std::allocator<T>, true, true>;
+
+struct StageStats
+{
+    uint64_t messages = 0;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point stop;
+
+    double rate() const
+    {
+        const double seconds = std::chrono::duration<double>(stop - start).count();
+        return seconds > 0 ? messages / seconds : 0.0;
+    }
+};
+
+struct Stage
+{
+    StageStats stats;
+    std::exception_ptr error;
+    // Set once the stage has returned, so the stage feeding it stops pushing
+    std::atomic<bool> stopped{false};
+};
+
+// Run a stage, keeping any exception it throws to report once the pipeline has drained
+template <typename F>
+void runStage(Stage& stage, F&& f)
+{
+    try
+    {
+        f();
+    }
+    catch (...)
+    {
+        stage.error = std::current_exception();
+    }
+    stage.stopped.store(true, std::memory_order_release);
+}
+
+uint64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// The stages busy poll, yielding while blocked so that the pipeline also runs on fewer cores than
+// threads. A push gives up, returning false, once the consumer has stopped.
+template <typename T>
+bool push(Queue<T>& q, const T& v, const std::atomic<bool>& consumerStopped)
+{
+    while (!q.try_push(v))
+    {
+        if (consumerStopped.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+template <typename T>
+T pop(Queue<T>& q)
+{
+    T* v;
+    while (!(v = q.front()))
+    {
+        std::this_thread::yield();
+    }
+    const T result = *v;
+    q.pop();
+    return result;
+}
+
+FILE* openFile(const std::string& path, const char* mode)
+{
+    if (path == "-")
+    {
+        return mode[0] == 'r' ? stdin : stdout;
+    }
+    FILE* file = std::fopen(path.c_str(), mode);
+    if (!file)
+    {
+        throw std::runtime_error("Failed to open " + path + ", " + std::strerror(errno));
+    }
+    return file;
+}
+
+void closeFile(FILE* file)
+{
+    if (file != stdin && file != stdout)
+    {
+        std::fclose(file);
+    }
+    else
+    {
+        std::fflush(file);
+    }
+}
+
+template <typename V>
+void put(char*& p, const V value)
+{
+    std::memcpy(p, &value, sizeof(value));
+    p += sizeof(value);
+}
+
+template <typename V>
+V get(const char*& p)
+{
+    V value;
+    std::memcpy(&value, p, sizeof(value));
+    p += sizeof(value);
+    return value;
+}
+
+void parse(FILE* input, Queue<Request>& requests, StageStats& stats, const std::atomic<bool>& matcherStopped)
+{
+    constexpr size_t batch = 4096;
+    std::vector<char> buffer(batch * requestSize);
+    stats.start = std::chrono::steady_clock::now();
+    // Bytes of a record split across two reads, moved to the front of the buffer
+    size_t carried = 0;
+    size_t count;
+    while ((count = std::fread(buffer.data() + carried, 1, buffer.size() - carried, input)) > 0)
+    {
+        const size_t bytes = carried + count;
+        const size_t records = bytes / requestSize;
+        for (size_t i = 0; i < records; ++i)
+        {
+            const char* p = &buffer[i * requestSize];
+            const char type = get<char>(p);
+            const char side = get<char>(p);
+            Request request;
+            request.order.size = get<SizeT>(p);
+            request.order.oid = get<OrderIdT>(p);
+            request.order.price = get<PriceT>(p);
+            if (type != 'A' && type != 'X')
+            {
+                throw std::runtime_error("Unknown request type " + std::to_string(static_cast<int>(type))
+                                         + " in record " + std::to_string(stats.messages));
+            }
+            if (side != 'B' && side != 'A')
+            {
+                throw std::runtime_error("Unknown side " + std::to_string(static_cast<int>(side)) + " in record "
+                                         + std::to_string(stats.messages));
+            }
+            // The book would throw too, but only once the matcher reaches the record
+            if (!std::isfinite(request.order.price))
+            {
+                throw std::runtime_error("Price is not finite in record " + std::to_string(stats.messages));
+            }
+            if (type == 'A' && request.order.size == 0)
+            {
+                throw std::runtime_error("Add with no size in record " + std::to_string(stats.messages));
+            }
+            request.type = type == 'A' ? Request::Type::Add : Request::Type::Cancel;
+            request.order.side = side == 'B' ? Side::BID : Side::ASK;
+            request.ingestNs = nowNs();
+            if (!push(requests, request, matcherStopped))
+            {
+                return;
+            }
+            ++stats.messages;
+        }
+        carried = bytes - records * requestSize;
+        std::memmove(buffer.data(), buffer.data() + records * requestSize, carried);
+    }
+    if (std::ferror(input))
+    {
+        throw std::runtime_error(std::string("Failed to read input, ") + std::strerror(errno));
+    }
+    if (carried > 0)
+    {
+        throw std::runtime_error("Input ends with a partial record of " + std::to_string(carried) + " bytes");
+    }
+    stats.stop = std::chrono::steady_clock::now();
+}
+
+// O(1), the levels keep a running total of their sizes
+template <typename Levels>
+DepthLevel bestLevel(const Levels& levels)
+{
+    DepthLevel result{0, 0, 0};
+    if (!levels.empty())
+    {
+        const auto& [price, level] = *levels.begin();
+        result.price = price;
+        result.size = level.totalSize();
+        result.orders = static_cast<uint32_t>(level.size());
+    }
+    return result;
+}
+
+bool operator!=(const DepthLevel& a, const DepthLevel& b)
+{
+    return a.price != b.price || a.size != b.size;
+}
+
+void match(Queue<Request>& requests, Queue<Event>& events, StageStats& stats, const std::atomic<bool>& publisherStopped)
+{
+    static const std::string bidSide = "B";
+    static const std::string askSide = "A";
+    MapOrderBook book;
+    DepthLevel bid{0, 0, 0};
+    DepthLevel ask{0, 0, 0};
+    while (true)
+    {
+        const Request request = pop(requests);
+        if (request.type == Request::Type::End)
+        {
+            break;
+        }
+        if (stats.messages++ == 0)
+        {
+            stats.start = std::chrono::steady_clock::now();
+        }
+
+        const Order& order = request.order;
+        if (request.type == Request::Type::Cancel)
+        {
+            book.cancel(order.oid);
+        }
+        else
+        {
+            for (const Fill& fill :
+                 book.add(order.oid, order.side == Side::BID ? bidSide : askSide, order.price, order.size))
+            {
+                Event event{};
+                event.type = Event::Type::Fill;
+                event.ingestNs = request.ingestNs;
+                event.aggressor = fill.aggressorOid;
+                event.passive = fill.passiveOid;
+                event.price = fill.price;
+                event.size = fill.size;
+                if (!push(events, event, publisherStopped))
+                {
+                    return;
+                }
+            }
+        }
+
+        const DepthLevel newBid = bestLevel(book.getBids());
+        const DepthLevel newAsk = bestLevel(book.getAsks());
+        if (newBid != bid || newAsk != ask)
+        {
+            bid = newBid;
+            ask = newAsk;
+            Event event{};
+            event.type = Event::Type::Depth;
+            event.ingestNs = request.ingestNs;
+            event.bid = bid;
+            event.ask = ask;
+            if (!push(events, event, publisherStopped))
+            {
+                return;
+            }
+        }
+    }
+    stats.stop = std::chrono::steady_clock::now();
+}
+
+void write(FILE* output, const std::vector<char>& buffer, const size_t bytes)
+{
+    if (std::fwrite(buffer.data(), 1, bytes, output) != bytes)
+    {
+        throw std::runtime_error(std::string("Failed to write output, ") + std::strerror(errno));
+    }
+}
+
+void publish(FILE* output, Queue<Event>& events, StageStats& stats, std::vector<int64_t>& latencies)
+{
+    std::vector<char> buffer(1 << 16);
+    char* p = buffer.data();
+    while (true)
+    {
+        const Event event = pop(events);
+        if (event.type == Event::Type::End)
+        {
+            break;
+        }
+        if (stats.messages++ == 0)
+        {
+            stats.start = std::chrono::steady_clock::now();
+        }
+
+        if (static_cast<size_t>(buffer.data() + buffer.size() - p) < depthSize)
+        {
+            write(output, buffer, p - buffer.data());
+            p = buffer.data();
+        }
+        if (event.type == Event::Type::Fill)
+        {
+            put<char>(p, 'F');
+            put<char>(p, 0);
+            put<SizeT>(p, event.size);
+            put<OrderIdT>(p, event.aggressor);
+            put<OrderIdT>(p, event.passive);
+            put<uint32_t>(p, 0);
+            put<PriceT>(p, event.price);
+        }
+        else
+        {
+            put<char>(p, 'D');
+            put<char>(p, 0);
+            put<uint16_t>(p, 0);
+            put<uint32_t>(p, static_cast<uint32_t>(std::min<uint64_t>(event.bid.size, UINT32_MAX)));
+            put<uint32_t>(p, static_cast<uint32_t>(std::min<uint64_t>(event.ask.size, UINT32_MAX)));
+            put<uint32_t>(p, 0);
+            put<PriceT>(p, event.bid.price);
+            put<PriceT>(p, event.ask.price);
+        }
+        latencies.push_back(static_cast<int64_t>(nowNs() - event.ingestNs));
+    }
+    write(output, buffer, p - buffer.data());
+    if (std::fflush(output) != 0)
+    {
+        throw std::runtime_error(std::string("Failed to write output, ") + std::strerror(errno));
+    }
+    stats.stop = std::chrono::steady_clock::now();
+}
+
+// Random adds around a mid price of 100 with a one cent tick, and cancels of earlier orders
+void generate(FILE* output, const uint64_t count)
+{
+    std::mt19937_64 rng(42);
+    std::vector<OrderIdT> live;
+    OrderIdT nextOid = 1;
+    char record[requestSize];
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        char* p = record;
+        if (!live.empty() && rng() % 100 < 45)
+        {
+            const size_t j = rng() % live.size();
+            const OrderIdT oid = live[j];
+            live[j] = live.back();
+            live.pop_back();
+            put<char>(p, 'X');
+            put<char>(p, 'B');
+            put<SizeT>(p, 0);
+            put<OrderIdT>(p, oid);
+            put<PriceT>(p, 0);
+        }
+        else
+        {
+            const bool bid = rng() % 2 == 0;
+            // Mostly resting orders a few ticks from the mid, with some crossing it
+            const int ticks = static_cast<int>(rng() % 20) - 3;
+            const PriceT price = (10000 + (bid ? -ticks : ticks)) / 100.0;
+            put<char>(p, 'A');
+            put<char>(p, bid ? 'B' : 'A');
+            put<SizeT>(p, static_cast<SizeT>(rng() % 100 + 1));
+            put<OrderIdT>(p, nextOid);
+            put<PriceT>(p, price);
+            live.push_back(nextOid++);
+        }
+        if (std::fwrite(record, 1, requestSize, output) != requestSize)
+        {
+            throw std::runtime_error(std::string("Failed to write input, ") + std::strerror(errno));
+        }
+    }
+    if (std::fflush(output) != 0)
+    {
+        throw std::runtime_error(std::string("Failed to write input, ") + std::strerror(errno));
+    }
+}
+
+int64_t percentile(const std::vector<int64_t>& sorted, const double p)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+template <typename T>
+void printTelemetry(const std::string& name, const Queue<T>& q)
+{
+    const SPSCQueueTelemetry telemetry = q.telemetry();
+    std::cerr << name << " queue: full stalls " << telemetry.fullStalls << ", try push failures "
+              << telemetry.tryEmplaceFailures << ", empty polls " << telemetry.emptyPolls << ", high water mark "
+              << telemetry.highWaterMark << "/" << q.capacity() << std::endl;
+}
+
+Config parseArgs(const int argc, char** argv)
+{
+    Config config;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (i + 1 == argc)
+        {
+            throw std::runtime_error("Missing value for " + arg);
+        }
+        const char* value = argv[++i];
+        if (arg == "--input")
+        {
+            config.input = value;
+        }
+        else if (arg == "--output")
+        {
+            config.output = value;
+        }
+        else if (arg == "--queue-capacity")
+        {
+            config.queueCapacity = std::stoull(value);
+        }
+        else if (arg == "--generate")
+        {
+            config.generate = std::stoull(value);
+        }
+        else
+        {
+            throw std::runtime_error("Unknown argument, " + arg);
+        }
+    }
+    if (config.input.empty())
+    {
+        throw std::runtime_error("Missing --input");
+    }
+    return config;
+}
+
+// Run the pipeline, returning the first error of any stage, or nullptr
+std::exception_ptr run(const Config& config)
+{
+    FILE* input = openFile(config.input, "rb");
+    FILE* output = openFile(config.output, "wb");
+    auto requests = std::make_unique<Queue<Request>>(config.queueCapacity);
+    auto events = std::make_unique<Queue<Event>>(config.queueCapacity);
+    Stage parser;
+    Stage matcher;
+    Stage publisher;
+    std::vector<int64_t> latencies;
+
+    std::thread publishThread(
+        [&] { runStage(publisher, [&] { publish(output, *events, publisher.stats, latencies); }); });
+    std::thread matchThread(
+        [&]
+        {
+            runStage(matcher, [&] { match(*requests, *events, matcher.stats, publisher.stopped); });
+            Event end{};
+            end.type = Event::Type::End;
+            push(*events, end, publisher.stopped);
+        });
+    runStage(parser, [&] { parse(input, *requests, parser.stats, matcher.stopped); });
+    push(*requests, Request{Request::Type::End, Order{}, nowNs()}, matcher.stopped);
+    matchThread.join();
+    publishThread.join();
+    closeFile(input);
+    closeFile(output);
+
+    for (const Stage* stage : {&parser, &matcher, &publisher})
+    {
+        if (stage->error)
+        {
+            return stage->error;
+        }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cerr << "parse: " << parser.stats.messages << " requests, " << static_cast<uint64_t>(parser.stats.rate())
+              << " per second" << std::endl;
+    std::cerr << "match: " << matcher.stats.messages << " requests, " << static_cast<uint64_t>(matcher.stats.rate())
+              << " per second" << std::endl;
+    std::cerr << "publish: " << publisher.stats.messages << " events, "
+              << static_cast<uint64_t>(publisher.stats.rate()) << " per second" << std::endl;
+    std::cerr << "end to end latency ns: p50 " << percentile(latencies, 0.5) << ", p90 " << percentile(latencies, 0.9)
+              << ", p99 " << percentile(latencies, 0.99) << ", p99.9 " << percentile(latencies, 0.999) << ", max "
+              << (latencies.empty() ? 0 : latencies.back()) << std::endl;
+    printTelemetry("request", *requests);
+    printTelemetry("event", *events);
+    return nullptr;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        const Config config = parseArgs(argc, argv);
+        if (config.generate > 0)
+        {
+            FILE* output = openFile(config.input, "wb");
+            generate(output, config.generate);
+            closeFile(output);
+            return 0;
+        }
+        if (const std::exception_ptr error = run(config))
+        {
+            std::rethrow_exception(error);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
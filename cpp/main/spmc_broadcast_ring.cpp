@@ -0,0 +1,51 @@
+#include "lib/SPMCBroadcastRing.h"
+
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr int count = 10;
+SPMCBroadcastRing<int> ring{4, 3};
+std::mutex coutMutex;
+
+void producer()
+{
+    for (int i = 0; i < count; ++i)
+    {
+        ring.push(i);
+    }
+}
+
+void consumer(const size_t id, const std::string& name)
+{
+    for (int n = 0; n < count; ++n)
+    {
+        const int* i;
+        while (!(i = ring.front(id)))
+        {
+            std::this_thread::yield();
+        }
+        {
+            std::lock_guard<std::mutex> lock{coutMutex};
+            std::cout << name << " read " << *i << std::endl;
+        }
+        ring.pop(id);
+    }
+}
+
+int main()
+{
+    std::vector<std::thread> consumers;
+    consumers.emplace_back(consumer, 0, "journal");
+    consumers.emplace_back(consumer, 1, "publisher");
+    consumers.emplace_back(consumer, 2, "risk");
+    std::thread pthread{producer};
+
+    pthread.join();
+    for (auto& cthread : consumers)
+    {
+        cthread.join();
+    }
+}
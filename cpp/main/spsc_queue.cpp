@@ -16,13 +16,15 @@ void producer()
 
 void consumer()
 {
-    while (true)
+    int popped = 0;
+    while (popped < 10)
     {
         const int* i = q.front();
         if (i)
         {
-            q.pop();
             std::cout << "Pop " << *i << std::endl;
+            q.pop();
+            ++popped;
         }
     }
 }
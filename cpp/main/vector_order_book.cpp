@@ -1,5 +1,4 @@
 #include <iostream>
-#include <numeric>
 
 #include "lib/VectorOrderBook.h"
 
@@ -16,18 +15,12 @@ int main()
     const auto& asks = book.getAsks();
     for (auto it = asks.begin(); it != asks.end(); ++it)
     {
-        const auto& orders = it->getOrders();
-        const size_t size =
-            std::accumulate(orders.begin(), orders.end(), 0, [](size_t curr, const Order& o) { return curr + o.size; });
-        std::cout << "Ask $" << it->getPrice() << " for " << size << std::endl;
+        std::cout << "Ask $" << it->getPrice() << " for " << it->totalSize() << std::endl;
     }
 
     const auto& bids = book.getBids();
     for (auto it = bids.rbegin(); it != bids.rend(); ++it)
     {
-        const auto& orders = it->getOrders();
-        const size_t size =
-            std::accumulate(orders.begin(), orders.end(), 0, [](size_t curr, const Order& o) { return curr + o.size; });
-        std::cout << "Bid $" << it->getPrice() << " for " << size << std::endl;
+        std::cout << "Bid $" << it->getPrice() << " for " << it->totalSize() << std::endl;
     }
 }
\ No newline at end of file
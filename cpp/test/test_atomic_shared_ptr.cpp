@@ -0,0 +1,95 @@
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "lib/AtomicSharedPtr.h"
+
+// Snapshot whose fields must always agree, so a reader can detect a torn or freed object
+struct Snapshot
+{
+    static inline std::atomic<int> alive{0};
+
+    uint64_t sequence;
+    uint64_t check;
+
+    explicit Snapshot(const uint64_t sequence) : sequence(sequence), check(~sequence) { ++alive; }
+
+    ~Snapshot()
+    {
+        check = 0;
+        --alive;
+    }
+};
+
+TEST(AtomicSharedPtrTest, LoadStore)
+{
+    AtomicSharedPtr<const Snapshot> current;
+    EXPECT_EQ(current.load().get(), nullptr);
+
+    current.store(makeShared<const Snapshot, AtomicRefCount>(1));
+    const auto first = current.load();
+    EXPECT_EQ(first->sequence, 1);
+    EXPECT_EQ(first.useCount(), 2);
+
+    current.store(makeShared<const Snapshot, AtomicRefCount>(2));
+    EXPECT_EQ(current.load()->sequence, 2);
+    // The reader still owns the first snapshot after it was replaced
+    EXPECT_EQ(first->sequence, 1);
+    EXPECT_EQ(first.useCount(), 1);
+    EXPECT_EQ(Snapshot::alive, 2);
+}
+
+TEST(AtomicSharedPtrTest, Reclaim)
+{
+    {
+        AtomicSharedPtr<const Snapshot> current{makeShared<const Snapshot, AtomicRefCount>(1)};
+        for (uint64_t i = 2; i < 10; ++i)
+        {
+            current.store(makeShared<const Snapshot, AtomicRefCount>(i));
+            EXPECT_EQ(Snapshot::alive, 1);
+        }
+    }
+    EXPECT_EQ(Snapshot::alive, 0);
+}
+
+TEST(AtomicSharedPtrTest, ConcurrentReaders)
+{
+    constexpr uint64_t numStores = 2000;
+    AtomicSharedPtr<const Snapshot> current{makeShared<const Snapshot, AtomicRefCount>(0)};
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> errors{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r)
+    {
+        readers.emplace_back(
+            [&]
+            {
+                uint64_t last = 0;
+                while (!done.load(std::memory_order_acquire))
+                {
+                    const auto snapshot = current.load();
+                    // Sequences never go backwards and every snapshot is intact
+                    if (snapshot->check != ~snapshot->sequence || snapshot->sequence < last)
+                    {
+                        errors.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    last = snapshot->sequence;
+                }
+            });
+    }
+    for (uint64_t i = 1; i <= numStores; ++i)
+    {
+        current.store(makeShared<const Snapshot, AtomicRefCount>(i));
+    }
+    done.store(true, std::memory_order_release);
+    for (std::thread& reader : readers)
+    {
+        reader.join();
+    }
+    EXPECT_EQ(errors.load(), 0);
+    EXPECT_EQ(current.load()->sequence, numStores);
+    EXPECT_EQ(Snapshot::alive, 1);
+}
@@ -0,0 +1,172 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "lib/ChunkedPriceLevel.h"
+#include "lib/VectorPriceLevel.h"
+
+namespace
+{
+
+using Level = BasicChunkedPriceLevel<4>;
+
+std::vector<std::pair<OrderIdT, SizeT>> contents(const Level& level)
+{
+    std::vector<std::pair<OrderIdT, SizeT>> result;
+    level.forEach([&](const OrderIdT oid, const SizeT size) { result.emplace_back(oid, size); });
+    return result;
+}
+
+}  // namespace
+
+TEST(ChunkedPriceLevelTest, AddAndMatch)
+{
+    Level::Pool pool;
+    Level level(5, pool);
+    EXPECT_TRUE(level.empty());
+    for (OrderIdT oid = 1; oid <= 10; ++oid)
+    {
+        level.add(Order{oid, 10, Side::ASK, 5});
+    }
+    EXPECT_EQ(level.size(), 10);
+    EXPECT_EQ(level.totalSize(), 100);
+    EXPECT_EQ(pool.allocated(), 3);
+
+    // Sweeps the first chunk and part of the second
+    std::vector<Fill> fills;
+    Order order{100, 55, Side::BID, 5};
+    level.match(order, fills);
+    EXPECT_EQ(order.size, 0);
+    ASSERT_EQ(fills.size(), 6);
+    for (size_t i = 0; i < 5; ++i)
+    {
+        EXPECT_EQ(fills[i].passiveOid, i + 1);
+        EXPECT_EQ(fills[i].size, 10);
+        EXPECT_TRUE(fills[i].passiveFilled);
+    }
+    EXPECT_EQ(fills[5].aggressorOid, 100);
+    EXPECT_EQ(fills[5].passiveOid, 6);
+    EXPECT_EQ(fills[5].price, 5);
+    EXPECT_EQ(fills[5].size, 5);
+    EXPECT_EQ(fills[5].passiveRemaining, 5);
+    EXPECT_FALSE(fills[5].passiveFilled);
+
+    EXPECT_EQ(level.size(), 5);
+    EXPECT_EQ(level.totalSize(), 45);
+    EXPECT_EQ(pool.available(), 1);
+}
+
+TEST(ChunkedPriceLevelTest, Cancel)
+{
+    Level::Pool pool;
+    Level level(5, pool);
+    std::vector<Level::Position> positions;
+    for (OrderIdT oid = 1; oid <= 8; ++oid)
+    {
+        positions.push_back(level.add(Order{oid, static_cast<SizeT>(oid), Side::BID, 5}));
+    }
+
+    level.cancel(positions[1]);
+    level.cancel(positions[6]);
+    const std::vector<std::pair<OrderIdT, SizeT>> expected{{1, 1}, {3, 3}, {4, 4}, {5, 5}, {6, 6}, {8, 8}};
+    EXPECT_EQ(contents(level), expected);
+
+    // Emptying the second chunk hands it back to the pool
+    level.cancel(positions[4]);
+    level.cancel(positions[5]);
+    level.cancel(positions[7]);
+    EXPECT_EQ(pool.available(), 1);
+
+    // Cancelled orders do not trade
+    std::vector<Fill> fills;
+    Order order{100, 100, Side::ASK, 5};
+    level.match(order, fills);
+    ASSERT_EQ(fills.size(), 3);
+    EXPECT_EQ(fills[0].passiveOid, 1);
+    EXPECT_EQ(fills[1].passiveOid, 3);
+    EXPECT_EQ(fills[2].passiveOid, 4);
+    EXPECT_EQ(order.size, 92);
+    EXPECT_TRUE(level.empty());
+    EXPECT_EQ(pool.available(), 2);
+}
+
+TEST(ChunkedPriceLevelTest, PoolSharedByLevels)
+{
+    Level::Pool pool;
+    {
+        Level a(1, pool);
+        for (OrderIdT oid = 1; oid <= 8; ++oid)
+        {
+            a.add(Order{oid, 1, Side::BID, 1});
+        }
+        EXPECT_EQ(pool.allocated(), 2);
+    }
+    EXPECT_EQ(pool.available(), 2);
+
+    // A new level reuses the chunks, and moving a level keeps its orders
+    Level b(2, pool);
+    for (OrderIdT oid = 1; oid <= 8; ++oid)
+    {
+        b.add(Order{oid, 1, Side::BID, 2});
+    }
+    EXPECT_EQ(pool.allocated(), 2);
+    EXPECT_EQ(pool.available(), 0);
+    Level c(std::move(b));
+    EXPECT_EQ(c.size(), 8);
+    EXPECT_EQ(c.getPrice(), 2);
+}
+
+TEST(ChunkedPriceLevelTest, MatchesVectorPriceLevel)
+{
+    std::mt19937 rng(3);
+    Level::Pool pool;
+    Level level(7, pool);
+    VectorPriceLevel expected(7);
+    std::vector<std::pair<OrderIdT, Level::Position>> resting;
+    OrderIdT nextOid = 1;
+    for (int i = 0; i < 10000; ++i)
+    {
+        const unsigned action = rng() % 10;
+        if (action < 6)
+        {
+            const Order order{nextOid++, static_cast<SizeT>(rng() % 50 + 1), Side::BID, 7};
+            resting.emplace_back(order.oid, level.add(order));
+            expected.add(order);
+        }
+        else if (action < 8 && !resting.empty())
+        {
+            const size_t j = rng() % resting.size();
+            level.cancel(resting[j].second);
+            EXPECT_TRUE(expected.cancel(resting[j].first));
+            resting.erase(resting.begin() + j);
+        }
+        else
+        {
+            Order order{nextOid++, static_cast<SizeT>(rng() % 200 + 1), Side::ASK, 7};
+            Order expectedOrder = order;
+            std::vector<Fill> fills;
+            std::vector<Fill> expectedFills;
+            level.match(order, fills);
+            expected.match(expectedOrder, expectedFills);
+            ASSERT_EQ(fills.size(), expectedFills.size());
+            for (size_t j = 0; j < fills.size(); ++j)
+            {
+                EXPECT_EQ(fills[j].passiveOid, expectedFills[j].passiveOid);
+                EXPECT_EQ(fills[j].size, expectedFills[j].size);
+                EXPECT_EQ(fills[j].passiveRemaining, expectedFills[j].passiveRemaining);
+                if (fills[j].passiveFilled)
+                {
+                    resting.erase(std::find_if(resting.begin(),
+                                               resting.end(),
+                                               [&](const auto& r) { return r.first == fills[j].passiveOid; }));
+                }
+            }
+            EXPECT_EQ(order.size, expectedOrder.size);
+        }
+        ASSERT_EQ(level.size(), expected.size());
+        ASSERT_EQ(level.totalSize(), expected.totalSize());
+    }
+}
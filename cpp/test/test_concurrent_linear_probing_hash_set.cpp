@@ -0,0 +1,177 @@
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "lib/ConcurrentLinearProbingHashSet.h"
+
+class ConcurrentLinearProbingHashSetTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        EXPECT_TRUE(hs.insert(1));
+        EXPECT_TRUE(hs.contains(1));
+        EXPECT_TRUE(hs.insert(2));
+        EXPECT_TRUE(hs.contains(2));
+        EXPECT_TRUE(hs.insert(3));
+        EXPECT_TRUE(hs.contains(3));
+        EXPECT_FALSE(hs.insert(3));
+        EXPECT_FALSE(hs.contains(4));
+        EXPECT_EQ(hs.size(), 3);
+    }
+
+    ConcurrentLinearProbingHashSet<uint64_t, 0> hs{10};
+};
+
+TEST_F(ConcurrentLinearProbingHashSetTest, Insert)
+{
+    EXPECT_EQ(hs.capacity(), 16);
+    EXPECT_TRUE(hs.insert(4));
+    EXPECT_TRUE(hs.contains(4));
+    EXPECT_EQ(hs.size(), 4);
+    EXPECT_THROW(hs.insert(0), std::invalid_argument);
+    EXPECT_FALSE(hs.contains(0));
+}
+
+TEST_F(ConcurrentLinearProbingHashSetTest, Remove)
+{
+    EXPECT_FALSE(hs.remove(4));
+    EXPECT_TRUE(hs.remove(1));
+    EXPECT_FALSE(hs.contains(1));
+    EXPECT_TRUE(hs.contains(2));
+    EXPECT_TRUE(hs.contains(3));
+    EXPECT_EQ(hs.size(), 2);
+}
+
+TEST(ConcurrentLinearProbingHashSetCollisionTest, RemoveCollisions)
+{
+    // With the identity hash 17 and 33 share the home slot of 1 and have to be shifted back when 1 is
+    // removed
+    ConcurrentLinearProbingHashSet<uint64_t, 0, std::hash<uint64_t>> hs{10};
+    EXPECT_TRUE(hs.insert(1));
+    EXPECT_TRUE(hs.insert(2));
+    EXPECT_TRUE(hs.insert(3));
+    EXPECT_TRUE(hs.insert(17));
+    EXPECT_TRUE(hs.insert(33));
+    EXPECT_TRUE(hs.remove(1));
+    EXPECT_TRUE(hs.contains(17));
+    EXPECT_TRUE(hs.contains(33));
+    EXPECT_TRUE(hs.remove(17));
+    EXPECT_TRUE(hs.contains(33));
+    EXPECT_EQ(hs.size(), 3);
+}
+
+TEST_F(ConcurrentLinearProbingHashSetTest, Grow)
+{
+    for (uint64_t i = 4; i <= 100; ++i)
+    {
+        EXPECT_TRUE(hs.insert(i));
+    }
+    EXPECT_EQ(hs.size(), 100);
+    EXPECT_LE(hs.loadFactor(), hs.maxLoadFactor());
+    // With no reader inside contains, every resize frees the table it replaced straight away
+    EXPECT_EQ(hs.retired(), 0);
+    for (uint64_t i = 1; i <= 100; ++i)
+    {
+        EXPECT_TRUE(hs.contains(i));
+    }
+}
+
+TEST_F(ConcurrentLinearProbingHashSetTest, Reserve)
+{
+    hs.reserve(1000);
+    const size_t capacity = hs.capacity();
+    EXPECT_GE(capacity * hs.maxLoadFactor(), 1000);
+    for (uint64_t i = 4; i <= 1000; ++i)
+    {
+        hs.insert(i);
+    }
+    EXPECT_EQ(hs.capacity(), capacity);
+}
+
+TEST(ConcurrentLinearProbingHashSetRandomTest, MatchesUnorderedSet)
+{
+    ConcurrentLinearProbingHashSet<uint32_t, 0> hs;
+    std::unordered_set<uint32_t> expected;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> keys(1, 512);
+    for (int i = 0; i < 20000; ++i)
+    {
+        const uint32_t key = keys(rng);
+        if (rng() % 2)
+        {
+            EXPECT_EQ(hs.insert(key), expected.insert(key).second);
+        }
+        else
+        {
+            EXPECT_EQ(hs.remove(key), expected.erase(key) == 1);
+        }
+    }
+    EXPECT_EQ(hs.size(), expected.size());
+    for (uint32_t key = 1; key <= 512; ++key)
+    {
+        EXPECT_EQ(hs.contains(key), expected.count(key) == 1);
+    }
+}
+
+TEST(ConcurrentLinearProbingHashSetThreadTest, ReadersSeeStableKeys)
+{
+    // Even keys are inserted up front and never removed, odd keys churn while readers look up the even
+    // ones, which forces both resizes and backward shifts under the readers
+    constexpr uint64_t numStable = 1000;
+    ConcurrentLinearProbingHashSet<uint64_t, 0> hs;
+    for (uint64_t i = 1; i <= numStable; ++i)
+    {
+        hs.insert(2 * i);
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> misses{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; ++r)
+    {
+        readers.emplace_back(
+            [&]
+            {
+                while (!done.load(std::memory_order_acquire))
+                {
+                    for (uint64_t i = 1; i <= numStable; ++i)
+                    {
+                        if (!hs.contains(2 * i))
+                        {
+                            misses.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                    std::this_thread::yield();
+                }
+            });
+    }
+
+    for (int round = 0; round < 20; ++round)
+    {
+        for (uint64_t i = 0; i < 500; ++i)
+        {
+            hs.insert(2 * (round * 500 + i) + 1);
+        }
+        for (uint64_t i = 0; i < 500; ++i)
+        {
+            hs.remove(2 * (round * 500 + i) + 1);
+        }
+        std::this_thread::yield();
+    }
+    done.store(true, std::memory_order_release);
+    for (std::thread& reader : readers)
+    {
+        reader.join();
+    }
+    EXPECT_EQ(misses.load(), 0);
+    EXPECT_EQ(hs.size(), numStable);
+    hs.reclaim();
+    EXPECT_EQ(hs.retired(), 0);
+}
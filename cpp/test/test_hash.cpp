@@ -0,0 +1,53 @@
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+#include "gtest/gtest.h"
+
+#include "lib/Hash.h"
+
+TEST(FibonacciHashTest, SpreadsSequentialKeys)
+{
+    // Sequential keys must not fall into consecutive slots of a power of two table
+    constexpr size_t mask = 1023;
+    FibonacciHash hasher;
+    std::unordered_set<size_t> slots;
+    size_t adjacent = 0;
+    for (uint64_t key = 1; key <= 512; ++key)
+    {
+        const size_t slot = hasher(key) & mask;
+        slots.insert(slot);
+        adjacent += ((hasher(key + 1) & mask) == ((slot + 1) & mask));
+    }
+    EXPECT_GT(slots.size(), 300);
+    EXPECT_LT(adjacent, 10);
+}
+
+TEST(FibonacciHashTest, Deterministic)
+{
+    FibonacciHash hasher;
+    EXPECT_EQ(hasher(uint32_t{42}), hasher(uint64_t{42}));
+    EXPECT_NE(hasher(1), hasher(2));
+}
+
+TEST(WyHashTest, AllLengths)
+{
+    WyHash hasher;
+    const std::string text = "the quick brown fox jumps over the lazy dog, 0123456789";
+    std::unordered_set<size_t> hashes;
+    for (size_t length = 0; length <= text.size(); ++length)
+    {
+        const std::string_view prefix(text.data(), length);
+        EXPECT_EQ(hasher(prefix), hasher(std::string(prefix)));
+        hashes.insert(hasher(prefix));
+    }
+    EXPECT_EQ(hashes.size(), text.size() + 1);
+}
+
+TEST(WyHashTest, Seed)
+{
+    EXPECT_EQ(WyHash{}("AAPL"), WyHash{}("AAPL"));
+    EXPECT_NE(WyHash{1}("AAPL"), WyHash{2}("AAPL"));
+    EXPECT_NE(WyHash{}("AAPL"), WyHash{}("AAPM"));
+}
@@ -0,0 +1,130 @@
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "lib/HugePageAllocator.h"
+#include "lib/MapOrderBook.h"
+#include "lib/SPSCQueue.h"
+#include "lib/SharedPtr.h"
+#include "lib/VectorOrderBook.h"
+
+TEST(HugePageAllocatorTest, ArenaAllocate)
+{
+    HugePageArena arena(1);
+    EXPECT_EQ(arena.capacity(), 2 * 1024 * 1024);
+    EXPECT_EQ(arena.used(), 0);
+
+    void* a = arena.allocate(24);
+    void* b = arena.allocate(24);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % 16, 0);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % 16, 0);
+    EXPECT_EQ(arena.used(), 64);
+
+    // Freed blocks are reused by the same size class
+    arena.deallocate(a, 24);
+    EXPECT_EQ(arena.allocate(32), a);
+    EXPECT_EQ(arena.used(), 64);
+}
+
+TEST(HugePageAllocatorTest, ArenaExhausted)
+{
+    HugePageArena arena(1, HugePageArena::noNode, false);
+    EXPECT_THROW(arena.allocate(4 * 1024 * 1024), std::bad_alloc);
+    void* a = arena.allocate(arena.capacity());
+    EXPECT_NE(a, nullptr);
+    EXPECT_THROW(arena.allocate(1), std::bad_alloc);
+}
+
+TEST(HugePageAllocatorTest, ArenaAligned)
+{
+    HugePageArena arena(3 * 1024 * 1024, HugePageArena::noNode, false);
+    EXPECT_EQ(arena.capacity(), 4 * 1024 * 1024);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(arena.allocate(16)) % (2 * 1024 * 1024), 0);
+}
+
+TEST(HugePageAllocatorTest, ArenaNode)
+{
+    EXPECT_THROW(HugePageArena(1, -2), std::invalid_argument);
+    // Node numbers past the first word of the node mask are passed to the kernel, which has no such node
+    EXPECT_THROW(HugePageArena(1, 100), std::runtime_error);
+}
+
+TEST(HugePageAllocatorTest, Vector)
+{
+    HugePageArena arena(1);
+    std::vector<int, HugePageAllocator<int>> v(HugePageAllocator<int>{arena});
+    for (int i = 0; i < 1000; ++i)
+    {
+        v.push_back(i);
+    }
+    for (int i = 0; i < 1000; ++i)
+    {
+        EXPECT_EQ(v[i], i);
+    }
+    EXPECT_GT(arena.used(), 4000);
+}
+
+TEST(HugePageAllocatorTest, SPSCQueue)
+{
+    HugePageArena arena(1);
+    SPSCQueue<int, HugePageAllocator<int>> q(10, HugePageAllocator<int>{arena});
+    // allocate_at_least rounds up to the size class
+    EXPECT_GE(q.capacity(), 10);
+    for (int i = 0; i < 10; ++i)
+    {
+        q.push(i);
+    }
+    for (int i = 0; i < 10; ++i)
+    {
+        EXPECT_EQ(*q.front(), i);
+        q.pop();
+    }
+}
+
+TEST(HugePageAllocatorTest, MapOrderBook)
+{
+    HugePageArena arena(1);
+    BasicMapOrderBook<HugePageAllocator<Order>> book(HugePageAllocator<Order>{arena});
+    EXPECT_TRUE(book.add(1, "B", 1, 10).empty());
+    EXPECT_TRUE(book.add(2, "B", 2, 10).empty());
+    const auto fills = book.add(3, "A", 1, 15);
+    EXPECT_EQ(fills.size(), 2);
+    EXPECT_EQ(book.getBids().size(), 1);
+    EXPECT_TRUE(book.cancel(1));
+    EXPECT_TRUE(book.getBids().empty());
+    EXPECT_GT(arena.used(), 0);
+}
+
+TEST(HugePageAllocatorTest, VectorOrderBook)
+{
+    HugePageArena arena(1);
+    BasicVectorOrderBook<HugePageAllocator<Order>> book(HugePageAllocator<Order>{arena});
+    EXPECT_TRUE(book.add(1, "A", 2, 10).empty());
+    EXPECT_TRUE(book.add(2, "A", 1, 10).empty());
+    const auto fills = book.add(3, "B", 2, 15);
+    EXPECT_EQ(fills.size(), 2);
+    EXPECT_EQ(book.getAsks().size(), 1);
+    EXPECT_TRUE(book.cancel(1));
+    EXPECT_TRUE(book.getAsks().empty());
+    EXPECT_GT(arena.used(), 0);
+}
+
+TEST(HugePageAllocatorTest, SharedPtr)
+{
+    HugePageArena arena(1 << 20, HugePageArena::noNode, false);
+    const HugePageAllocator<uint64_t> allocator(arena);
+    uint64_t* first;
+    {
+        SharedPtr<uint64_t> a = allocateShared<uint64_t>(allocator, 42);
+        EXPECT_EQ(*a, 42);
+        EXPECT_GT(arena.used(), 0);
+        first = a.get();
+    }
+    // The released block went back to the arena free list and is handed out again
+    const size_t used = arena.used();
+    SharedPtr<uint64_t> b = allocateShared<uint64_t>(allocator, 7);
+    EXPECT_EQ(b.get(), first);
+    EXPECT_EQ(arena.used(), used);
+}
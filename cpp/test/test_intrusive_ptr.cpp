@@ -0,0 +1,137 @@
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "lib/IntrusivePtr.h"
+
+class Level : public RefCounted<Level>
+{
+public:
+    static inline int alive = 0;
+
+    int price;
+
+    explicit Level(const int price) : price(price) { ++alive; }
+
+    ~Level() { --alive; }
+};
+
+class SharedLevel : public RefCounted<SharedLevel, AtomicRefCount>
+{
+public:
+    static inline int alive = 0;
+
+    SharedLevel() { ++alive; }
+
+    ~SharedLevel() { --alive; }
+};
+
+// Returns released objects to a pool instead of deleting them
+class Pooled
+{
+public:
+    static inline std::vector<Pooled*> pool;
+
+    long refs = 0;
+
+    friend void intrusivePtrRetain(Pooled* p) noexcept { ++p->refs; }
+
+    friend void intrusivePtrRelease(Pooled* p) noexcept
+    {
+        if (--p->refs == 0)
+        {
+            pool.push_back(p);
+        }
+    }
+};
+
+TEST(IntrusivePtrTest, OnePointerWide)
+{
+    static_assert(sizeof(IntrusivePtr<Level>) == sizeof(Level*));
+    IntrusivePtr<Level> a;
+    EXPECT_FALSE(a);
+    EXPECT_EQ(a.get(), nullptr);
+}
+
+TEST(IntrusivePtrTest, CopyAndMove)
+{
+    {
+        IntrusivePtr<Level> a = makeIntrusive<Level>(100);
+        EXPECT_EQ(a->price, 100);
+        EXPECT_EQ(a->refCount(), 1);
+
+        IntrusivePtr<Level> b{a};
+        EXPECT_EQ(a, b);
+        EXPECT_EQ(a->refCount(), 2);
+
+        IntrusivePtr<Level> c{std::move(b)};
+        EXPECT_FALSE(b);
+        EXPECT_EQ(c->refCount(), 2);
+
+        c = c;
+        EXPECT_EQ(c->refCount(), 2);
+        c = IntrusivePtr<Level>();
+        EXPECT_EQ(a->refCount(), 1);
+        EXPECT_EQ(Level::alive, 1);
+
+        a = makeIntrusive<Level>(101);
+        EXPECT_EQ(Level::alive, 1);
+        EXPECT_EQ((*a).price, 101);
+    }
+    EXPECT_EQ(Level::alive, 0);
+}
+
+TEST(IntrusivePtrTest, AdoptAndDetach)
+{
+    Level* raw = new Level(5);
+    IntrusivePtr<Level> a{raw};
+    EXPECT_EQ(raw->refCount(), 1);
+
+    Level* detached = a.detach();
+    EXPECT_FALSE(a);
+    EXPECT_EQ(detached->refCount(), 1);
+
+    // The reference given up by detach is taken back without a second retain
+    a.reset(detached, false);
+    EXPECT_EQ(a->refCount(), 1);
+    a.reset();
+    EXPECT_EQ(Level::alive, 0);
+}
+
+TEST(IntrusivePtrTest, CustomHooks)
+{
+    Pooled object;
+    {
+        IntrusivePtr<Pooled> a{&object};
+        IntrusivePtr<Pooled> b{a};
+        EXPECT_EQ(object.refs, 2);
+    }
+    EXPECT_EQ(object.refs, 0);
+    ASSERT_EQ(Pooled::pool.size(), 1);
+    EXPECT_EQ(Pooled::pool.front(), &object);
+}
+
+TEST(IntrusivePtrTest, AtomicRefCount)
+{
+    IntrusivePtr<SharedLevel> a = makeIntrusive<SharedLevel>();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back(
+            [copy = a]
+            {
+                for (int i = 0; i < 10000; ++i)
+                {
+                    IntrusivePtr<SharedLevel> local{copy};
+                }
+            });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(a->refCount(), 1);
+    a.reset();
+    EXPECT_EQ(SharedLevel::alive, 0);
+}
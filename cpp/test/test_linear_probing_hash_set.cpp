@@ -1,5 +1,16 @@
+#include <cstdint>
+#include <memory>
+#include <functional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
 #include "gtest/gtest.h"
 
+#include "lib/Hash.h"
 #include "lib/LinearProbingHashSet.h"
 
 class LinearProbingHashSetTest : public testing::Test
@@ -50,8 +61,290 @@ TEST_F(LinearProbingHashSetTest, Remove)
 TEST_F(LinearProbingHashSetTest, Resize)
 {
     hs.resize(20);
+    EXPECT_EQ(hs.capacity(), 32);
     EXPECT_EQ(hs.size(), 3);
     EXPECT_TRUE(hs.contains(1));
     EXPECT_TRUE(hs.contains(2));
     EXPECT_TRUE(hs.contains(3));
-}
\ No newline at end of file
+}
+// std::hash<int> is the identity, which makes home slots easy to place by hand
+using IdentityHashSet = LinearProbingHashSet<int, OptionalSlot<int>, false, std::hash<int>>;
+
+TEST(LinearProbingHashSetCollisionTest, RemoveKeepsChain)
+{
+    // These all share home slot 1
+    IdentityHashSet hs{16};
+    EXPECT_TRUE(hs.insert(1));
+    EXPECT_TRUE(hs.insert(17));
+    EXPECT_TRUE(hs.insert(33));
+    EXPECT_TRUE(hs.insert(2));
+    EXPECT_TRUE(hs.remove(17));
+    EXPECT_TRUE(hs.contains(1));
+    EXPECT_FALSE(hs.contains(17));
+    EXPECT_TRUE(hs.contains(33));
+    EXPECT_TRUE(hs.contains(2));
+    EXPECT_TRUE(hs.remove(1));
+    EXPECT_TRUE(hs.contains(33));
+    EXPECT_TRUE(hs.contains(2));
+    EXPECT_EQ(hs.size(), 2);
+
+    // No tombstones are left behind, both items are back in their home slots
+    const ProbeStats stats = hs.probeStats();
+    EXPECT_EQ(stats.maxProbeLength, 0);
+}
+
+TEST(LinearProbingHashSetCollisionTest, RemoveWrapsAround)
+{
+    IdentityHashSet hs{16};
+    EXPECT_TRUE(hs.insert(15));
+    EXPECT_TRUE(hs.insert(31));
+    EXPECT_TRUE(hs.insert(47));
+    EXPECT_TRUE(hs.insert(0));
+    EXPECT_TRUE(hs.remove(15));
+    EXPECT_TRUE(hs.contains(31));
+    EXPECT_TRUE(hs.contains(47));
+    EXPECT_TRUE(hs.contains(0));
+    EXPECT_FALSE(hs.contains(15));
+}
+
+TEST(LinearProbingHashSetCollisionTest, Grow)
+{
+    LinearProbingHashSet<int> hs{4};
+    EXPECT_EQ(hs.capacity(), 4);
+    for (int i = 0; i < 3; ++i)
+    {
+        EXPECT_TRUE(hs.insert(i * 4));
+    }
+    EXPECT_EQ(hs.capacity(), 4);
+    EXPECT_FALSE(hs.insert(0));
+    EXPECT_EQ(hs.capacity(), 4);
+    EXPECT_TRUE(hs.insert(12));
+    EXPECT_EQ(hs.capacity(), 8);
+    for (int i = 0; i < 1000; ++i)
+    {
+        hs.insert(i);
+    }
+    EXPECT_EQ(hs.size(), 1000);
+    EXPECT_LE(hs.loadFactor(), hs.maxLoadFactor());
+    for (int i = 0; i < 1000; ++i)
+    {
+        EXPECT_TRUE(hs.contains(i));
+    }
+    EXPECT_FALSE(hs.contains(1000));
+}
+
+TEST(LinearProbingHashSetCollisionTest, Reserve)
+{
+    LinearProbingHashSet<int> hs{1, 0.5f};
+    hs.reserve(100);
+    EXPECT_EQ(hs.capacity(), 256);
+    const size_t capacity = hs.capacity();
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_TRUE(hs.insert(i));
+    }
+    EXPECT_EQ(hs.capacity(), capacity);
+    EXPECT_THROW(hs.maxLoadFactor(1.5f), std::invalid_argument);
+}
+
+TEST(LinearProbingHashSetCollisionTest, ProbeStats)
+{
+    IdentityHashSet hs{16};
+    EXPECT_TRUE(hs.insert(1));
+    EXPECT_TRUE(hs.insert(17));
+    EXPECT_TRUE(hs.insert(33));
+    EXPECT_TRUE(hs.insert(5));
+
+    const ProbeStats stats = hs.probeStats();
+    EXPECT_EQ(stats.maxProbeLength, 2);
+    EXPECT_DOUBLE_EQ(stats.meanProbeLength, 0.75);
+    ASSERT_EQ(stats.histogram.size(), 3);
+    EXPECT_EQ(stats.histogram[0], 2);
+    EXPECT_EQ(stats.histogram[1], 1);
+    EXPECT_EQ(stats.histogram[2], 1);
+}
+
+TEST(LinearProbingHashSetSentinelTest, InsertRemove)
+{
+    LinearProbingHashSet<uint32_t, SentinelSlot<uint32_t, UINT32_MAX>> hs{16};
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        EXPECT_TRUE(hs.insert(i * 16));
+    }
+    EXPECT_FALSE(hs.insert(0));
+    EXPECT_EQ(hs.size(), 100);
+    for (uint32_t i = 0; i < 100; i += 2)
+    {
+        EXPECT_TRUE(hs.remove(i * 16));
+    }
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        EXPECT_EQ(hs.contains(i * 16), i % 2 == 1);
+    }
+    EXPECT_EQ(hs.size(), 50);
+}
+
+TEST(LinearProbingHashSetSentinelTest, EmptyKey)
+{
+    LinearProbingHashSet<uint32_t, SentinelSlot<uint32_t, 0>> hs{16};
+    EXPECT_THROW(hs.insert(0), std::invalid_argument);
+    EXPECT_FALSE(hs.contains(0));
+    EXPECT_FALSE(hs.remove(0));
+    EXPECT_TRUE(hs.insert(16));
+    EXPECT_TRUE(hs.contains(16));
+    EXPECT_EQ(hs.size(), 1);
+}
+
+TEST(LinearProbingHashSetRobinHoodTest, MatchesUnorderedSet)
+{
+    LinearProbingHashSet<uint32_t, OptionalSlot<uint32_t>, true> hs{16, 0.9f};
+    std::unordered_set<uint32_t> expected;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> keys(0, 5000);
+    for (int i = 0; i < 100000; ++i)
+    {
+        const uint32_t key = keys(rng);
+        switch (rng() % 3)
+        {
+            case 0: EXPECT_EQ(hs.insert(key), expected.insert(key).second); break;
+            case 1: EXPECT_EQ(hs.remove(key), expected.erase(key) == 1); break;
+            default: EXPECT_EQ(hs.contains(key), expected.count(key) == 1); break;
+        }
+        ASSERT_EQ(hs.size(), expected.size());
+    }
+    for (uint32_t key = 0; key <= 5000; ++key)
+    {
+        EXPECT_EQ(hs.contains(key), expected.count(key) == 1);
+    }
+}
+
+TEST(LinearProbingHashSetRobinHoodTest, BoundsProbeLength)
+{
+    // Both tables hold the same keys, Robin Hood only reorders each cluster
+    LinearProbingHashSet<uint32_t, SentinelSlot<uint32_t, UINT32_MAX>> linear{1 << 12, 0.95f};
+    LinearProbingHashSet<uint32_t, SentinelSlot<uint32_t, UINT32_MAX>, true> robinHood{1 << 12, 0.95f};
+    std::mt19937 rng(7);
+    while (linear.size() < 3800)
+    {
+        const uint32_t key = rng() % UINT32_MAX;
+        EXPECT_EQ(linear.insert(key), robinHood.insert(key));
+    }
+    EXPECT_EQ(linear.capacity(), robinHood.capacity());
+
+    const ProbeStats linearStats = linear.probeStats();
+    const ProbeStats robinHoodStats = robinHood.probeStats();
+    EXPECT_DOUBLE_EQ(linearStats.meanProbeLength, robinHoodStats.meanProbeLength);
+    EXPECT_LT(robinHoodStats.maxProbeLength, linearStats.maxProbeLength);
+}
+
+TEST(LinearProbingHashSetBatchTest, ContainsBatch)
+{
+    LinearProbingHashSet<uint32_t> hs;
+    std::vector<uint32_t> keys;
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        keys.push_back(i);
+        if (i % 3 == 0)
+        {
+            hs.insert(i);
+        }
+    }
+
+    std::unique_ptr<bool[]> out(new bool[keys.size()]);
+    hs.containsBatch(keys.data(), keys.size(), out.get());
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        EXPECT_EQ(out[i], i % 3 == 0);
+    }
+}
+
+TEST(LinearProbingHashSetBatchTest, InsertBatch)
+{
+    LinearProbingHashSet<uint32_t, SentinelSlot<uint32_t, UINT32_MAX>, true> hs;
+    std::vector<uint32_t> keys;
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        keys.push_back(i % 60);
+    }
+
+    std::unique_ptr<bool[]> inserted(new bool[keys.size()]);
+    EXPECT_EQ(hs.insertBatch(keys.data(), keys.size(), inserted.get()), 60);
+    EXPECT_EQ(hs.size(), 60);
+    EXPECT_LE(hs.loadFactor(), hs.maxLoadFactor());
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        EXPECT_EQ(inserted[i], i < 60);
+        EXPECT_TRUE(hs.contains(keys[i]));
+    }
+    EXPECT_EQ(hs.insertBatch(keys.data(), keys.size()), 0);
+
+    const uint32_t emptyKey[] = {1000, UINT32_MAX};
+    EXPECT_THROW(hs.insertBatch(emptyKey, 2), std::invalid_argument);
+    EXPECT_TRUE(hs.contains(1000));
+}
+
+#ifdef __cpp_lib_span
+TEST(LinearProbingHashSetBatchTest, Span)
+{
+    LinearProbingHashSet<uint32_t> hs;
+    const std::vector<uint32_t> keys{1, 2, 3};
+    EXPECT_EQ(hs.insertBatch(std::span<const uint32_t>(keys)), 3);
+
+    bool out[4];
+    const uint32_t lookups[] = {0, 1, 2, 3};
+    hs.containsBatch(lookups, out);
+    EXPECT_FALSE(out[0]);
+    EXPECT_TRUE(out[1]);
+    EXPECT_TRUE(out[2]);
+    EXPECT_TRUE(out[3]);
+    EXPECT_THROW(hs.containsBatch(lookups, std::span<bool>(out, 2)), std::invalid_argument);
+}
+#endif
+
+TEST(LinearProbingHashSetHashTest, FibonacciHash)
+{
+    LinearProbingHashSet<uint64_t, SentinelSlot<uint64_t, 0>, false, FibonacciHash> hs{1024};
+    for (uint64_t i = 1; i <= 700; ++i)
+    {
+        EXPECT_TRUE(hs.insert(i));
+    }
+    for (uint64_t i = 1; i <= 700; ++i)
+    {
+        EXPECT_TRUE(hs.contains(i));
+    }
+    EXPECT_FALSE(hs.contains(701));
+    EXPECT_TRUE(hs.remove(350));
+    EXPECT_FALSE(hs.contains(350));
+    EXPECT_EQ(hs.size(), 699);
+}
+
+TEST(LinearProbingHashSetHashTest, DefaultHashMixesIntegers)
+{
+    static_assert(std::is_same<DefaultHash<uint64_t>, FibonacciHash>::value);
+    static_assert(std::is_same<DefaultHash<std::string>, std::hash<std::string>>::value);
+
+    // Sequential keys would fill one run of slots with the identity hash, so every miss scans the run
+    LinearProbingHashSet<uint64_t, SentinelSlot<uint64_t, 0>> hs{1024, 0.99f};
+    for (uint64_t i = 1; i <= 768; ++i)
+    {
+        EXPECT_TRUE(hs.insert(i));
+    }
+    EXPECT_EQ(hs.capacity(), 1024);
+    EXPECT_LT(hs.probeStats().maxProbeLength, 64);
+}
+
+TEST(LinearProbingHashSetHashTest, HeterogeneousLookup)
+{
+    LinearProbingHashSet<std::string, OptionalSlot<std::string>, false, WyHash, std::equal_to<>> hs;
+    EXPECT_TRUE(hs.insert("AAPL"));
+    EXPECT_TRUE(hs.insert("MSFT"));
+    EXPECT_FALSE(hs.insert(std::string("AAPL")));
+
+    const std::string_view symbol = "MSFT";
+    EXPECT_TRUE(hs.contains(symbol));
+    EXPECT_TRUE(hs.contains("AAPL"));
+    EXPECT_FALSE(hs.contains(std::string_view("GOOG")));
+    EXPECT_TRUE(hs.remove(symbol));
+    EXPECT_FALSE(hs.contains(std::string("MSFT")));
+    EXPECT_EQ(hs.size(), 1);
+}
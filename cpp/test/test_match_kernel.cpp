@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+
+#include <random>
+#include <vector>
+
+#include "lib/MatchKernel.h"
+
+TEST(MatchKernelTest, Empty)
+{
+    const MatchCutoff cutoff = matchCutoff(nullptr, 0, 10);
+    EXPECT_EQ(cutoff.index, 0);
+    EXPECT_EQ(cutoff.before, 0);
+}
+
+TEST(MatchKernelTest, Cutoff)
+{
+    const std::vector<SizeT> sizes{5, 3, 7, 2, 4, 6, 1, 8, 9, 3, 2};
+    // Inside the first order
+    EXPECT_EQ(matchCutoff(sizes.data(), sizes.size(), 4).index, 0);
+    // Exactly the first order
+    EXPECT_EQ(matchCutoff(sizes.data(), sizes.size(), 5).index, 0);
+    // Into the second order
+    MatchCutoff cutoff = matchCutoff(sizes.data(), sizes.size(), 6);
+    EXPECT_EQ(cutoff.index, 1);
+    EXPECT_EQ(cutoff.before, 5);
+    // Into the first order of the second group of eight
+    cutoff = matchCutoff(sizes.data(), sizes.size(), 40);
+    EXPECT_EQ(cutoff.index, 8);
+    EXPECT_EQ(cutoff.before, 36);
+    // Into the scalar tail
+    cutoff = matchCutoff(sizes.data(), sizes.size(), 48);
+    EXPECT_EQ(cutoff.index, 9);
+    EXPECT_EQ(cutoff.before, 45);
+    // More than the whole level
+    cutoff = matchCutoff(sizes.data(), sizes.size(), 100);
+    EXPECT_EQ(cutoff.index, sizes.size());
+    EXPECT_EQ(cutoff.before, 50);
+}
+
+TEST(MatchKernelTest, LargeSizes)
+{
+    const std::vector<SizeT> sizes(100, 65535);
+    const MatchCutoff cutoff = matchCutoff(sizes.data(), sizes.size(), 65535);
+    EXPECT_EQ(cutoff.index, 0);
+    EXPECT_EQ(cutoff.before, 0);
+    EXPECT_EQ(matchCutoff(sizes.data(), sizes.size(), 65534).index, 0);
+}
+
+#ifdef MATCH_KERNEL_AVX2
+TEST(MatchKernelTest, Avx2MatchesScalar)
+{
+    if (!hasAvx2())
+    {
+        GTEST_SKIP() << "The CPU has no AVX2";
+    }
+    std::mt19937 rng(7);
+    for (int round = 0; round < 1000; ++round)
+    {
+        std::vector<SizeT> sizes(rng() % 200);
+        for (SizeT& size : sizes)
+        {
+            // Some zero sizes to check they are swept past like any other order
+            size = static_cast<SizeT>(rng() % 8 == 0 ? 0 : rng() % 500 + 1);
+        }
+        const SizeT quantity = static_cast<SizeT>(rng() % 65535 + 1);
+        const MatchCutoff expected = matchCutoffScalar(sizes.data(), sizes.size(), quantity);
+        const MatchCutoff cutoff = matchCutoffAvx2(sizes.data(), sizes.size(), quantity);
+        EXPECT_EQ(cutoff.index, expected.index);
+        EXPECT_EQ(cutoff.before, expected.before);
+    }
+    EXPECT_EQ(matchCutoffAvx2(nullptr, 0, 10).index, 0);
+    const std::vector<SizeT> sizes(100, 65535);
+    EXPECT_EQ(matchCutoffAvx2(sizes.data(), sizes.size(), 65535).index, 0);
+    // The largest quantity still sweeps every order of a level holding less
+    const std::vector<SizeT> small(100, 600);
+    const MatchCutoff cutoff = matchCutoffAvx2(small.data(), small.size(), 65535);
+    EXPECT_EQ(cutoff.index, 100);
+    EXPECT_EQ(cutoff.before, 60000);
+}
+#endif
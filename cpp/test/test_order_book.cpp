@@ -0,0 +1,259 @@
+#include "gtest/gtest.h"
+
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "lib/MapOrderBook.h"
+#include "lib/OrderBook.h"
+#include "lib/VectorOrderBook.h"
+
+namespace
+{
+
+using TickArrayChunkedBook = OrderBook<TickPrice<100>,
+                                       ChunkedLevels<4>,
+                                       TickArrayLevelIndex<0, 20000>,
+                                       OpenAddressingOrderIndex<>,
+                                       BufferFillSink>;
+using MapChunkedBook = OrderBook<DoublePrice, ChunkedLevels<>, MapLevelIndex, OpenAddressingOrderIndex<>>;
+using TickVectorBook = OrderBook<TickPrice<100>, VectorLevels, SortedVectorLevelIndex, HashOrderIndex, BufferFillSink>;
+using TickArrayListBook = OrderBook<TickPrice<100>, ListLevels, TickArrayLevelIndex<0, 20000>>;
+
+}  // namespace
+
+template <typename Book>
+class OrderBookTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        EXPECT_TRUE(book.add(1, "B", 1, 11).empty());
+        EXPECT_TRUE(book.add(2, "B", 2, 12).empty());
+        EXPECT_TRUE(book.add(3, "B", 3, 13).empty());
+        EXPECT_TRUE(book.add(4, "A", 4, 14).empty());
+        EXPECT_TRUE(book.add(5, "A", 5, 15).empty());
+        EXPECT_TRUE(book.add(6, "A", 6, 16).empty());
+    }
+
+    Book book;
+};
+
+using Books = testing::Types<MapOrderBook, VectorOrderBook, TickArrayChunkedBook, MapChunkedBook, TickVectorBook,
+                             TickArrayListBook>;
+TYPED_TEST_SUITE(OrderBookTest, Books);
+
+TYPED_TEST(OrderBookTest, Levels)
+{
+    const BookSnapshot snapshot = this->book.snapshot(10);
+    ASSERT_EQ(snapshot.bids.size(), 3);
+    EXPECT_EQ(snapshot.bids[0].price, 3);
+    EXPECT_EQ(snapshot.bids[1].price, 2);
+    EXPECT_EQ(snapshot.bids[2].price, 1);
+    ASSERT_EQ(snapshot.asks.size(), 3);
+    EXPECT_EQ(snapshot.asks[0].price, 4);
+    EXPECT_EQ(snapshot.asks[1].price, 5);
+    EXPECT_EQ(snapshot.asks[2].price, 6);
+    EXPECT_EQ(snapshot.asks[2].size, 16);
+    EXPECT_EQ(snapshot.asks[2].orders, 1);
+}
+
+TYPED_TEST(OrderBookTest, AddAndCancel)
+{
+    EXPECT_TRUE(this->book.add(7, "B", 3.5, 10).empty());
+    EXPECT_TRUE(this->book.add(8, "B", 3.5, 5).empty());
+    EXPECT_THROW(this->book.add(8, "B", 3.5, 5), std::runtime_error);
+    EXPECT_THROW(this->book.add(9, "X", 3.5, 5), std::runtime_error);
+    BookSnapshot snapshot = this->book.snapshot(1);
+    EXPECT_EQ(snapshot.bestBid()->price, 3.5);
+    EXPECT_EQ(snapshot.bestBid()->size, 15);
+    EXPECT_EQ(snapshot.bestBid()->orders, 2);
+
+    EXPECT_FALSE(this->book.cancel(9));
+    EXPECT_TRUE(this->book.cancel(7));
+    EXPECT_FALSE(this->book.cancel(7));
+    EXPECT_EQ(this->book.snapshot(1).bestBid()->size, 5);
+    EXPECT_TRUE(this->book.cancel(8));
+    EXPECT_EQ(this->book.snapshot(1).bestBid()->price, 3);
+
+    // Cancel the best ask and then the rest of the side
+    EXPECT_TRUE(this->book.cancel(4));
+    EXPECT_EQ(this->book.snapshot(1).bestAsk()->price, 5);
+    EXPECT_TRUE(this->book.cancel(6));
+    EXPECT_TRUE(this->book.cancel(5));
+    EXPECT_EQ(this->book.snapshot(1).bestAsk(), nullptr);
+    EXPECT_TRUE(this->book.add(9, "A", 4.5, 1).empty());
+    EXPECT_EQ(this->book.snapshot(1).bestAsk()->price, 4.5);
+}
+
+TYPED_TEST(OrderBookTest, NonFinitePrice)
+{
+    // Would cross every level if let through, so it has to throw before matching
+    EXPECT_THROW(this->book.add(7, "B", std::numeric_limits<PriceT>::quiet_NaN(), 30), std::runtime_error);
+    EXPECT_THROW(this->book.add(8, "A", std::numeric_limits<PriceT>::quiet_NaN(), 30), std::runtime_error);
+    EXPECT_THROW(this->book.add(9, "B", std::numeric_limits<PriceT>::infinity(), 30), std::runtime_error);
+    EXPECT_THROW(this->book.add(10, "A", -std::numeric_limits<PriceT>::infinity(), 30), std::runtime_error);
+    EXPECT_FALSE(this->book.cancel(7));
+    const BookSnapshot snapshot = this->book.snapshot(10);
+    ASSERT_EQ(snapshot.bids.size(), 3);
+    ASSERT_EQ(snapshot.asks.size(), 3);
+    EXPECT_EQ(snapshot.bestBid()->price, 3);
+    EXPECT_EQ(snapshot.bestBid()->size, 13);
+    EXPECT_EQ(snapshot.bestAsk()->price, 4);
+    EXPECT_EQ(snapshot.bestAsk()->size, 14);
+}
+
+TYPED_TEST(OrderBookTest, Match)
+{
+    const auto& fills = this->book.add(7, "A", 2, 20);
+    ASSERT_EQ(fills.size(), 2);
+    EXPECT_EQ(fills[0].aggressorOid, 7);
+    EXPECT_EQ(fills[0].passiveOid, 3);
+    EXPECT_EQ(fills[0].price, 3);
+    EXPECT_EQ(fills[0].size, 13);
+    EXPECT_TRUE(fills[0].passiveFilled);
+    EXPECT_EQ(fills[1].passiveOid, 2);
+    EXPECT_EQ(fills[1].price, 2);
+    EXPECT_EQ(fills[1].size, 7);
+    EXPECT_EQ(fills[1].passiveRemaining, 5);
+    EXPECT_FALSE(fills[1].passiveFilled);
+
+    EXPECT_FALSE(this->book.cancel(3));
+    const BookSnapshot snapshot = this->book.snapshot(10);
+    ASSERT_EQ(snapshot.bids.size(), 2);
+    EXPECT_EQ(snapshot.bestBid()->price, 2);
+    EXPECT_EQ(snapshot.bestBid()->size, 5);
+
+    // Sweeps every ask and rests the remainder
+    EXPECT_EQ(this->book.add(8, "B", 10, 50).size(), 3);
+    EXPECT_EQ(this->book.snapshot(1).bestAsk(), nullptr);
+    EXPECT_EQ(this->book.snapshot(1).bestBid()->price, 10);
+    EXPECT_EQ(this->book.snapshot(1).bestBid()->size, 5);
+}
+
+TYPED_TEST(OrderBookTest, MatchesMapOrderBook)
+{
+    MapOrderBook expected;
+    expected.add(1, "B", 1, 11);
+    expected.add(2, "B", 2, 12);
+    expected.add(3, "B", 3, 13);
+    expected.add(4, "A", 4, 14);
+    expected.add(5, "A", 5, 15);
+    expected.add(6, "A", 6, 16);
+
+    std::mt19937 rng(11);
+    std::vector<OrderIdT> oids;
+    for (OrderIdT oid = 7; oid < 5000; ++oid)
+    {
+        if (!oids.empty() && rng() % 3 == 0)
+        {
+            const OrderIdT cancel = oids[rng() % oids.size()];
+            EXPECT_EQ(this->book.cancel(cancel), expected.cancel(cancel));
+        }
+        const bool bid = rng() % 2 == 0;
+        // Whole cents, with bids and asks overlapping so that most orders cross
+        const PriceT price = (bid ? 3.5 : 1.5) + static_cast<int>(rng() % 200) / 100.0;
+        const SizeT size = static_cast<SizeT>(rng() % 50 + 1);
+        const std::vector<Fill> fills = this->book.add(oid, bid ? "B" : "A", price, size);
+        const std::vector<Fill> expectedFills = expected.add(oid, bid ? "B" : "A", price, size);
+        ASSERT_EQ(fills.size(), expectedFills.size());
+        for (size_t i = 0; i < fills.size(); ++i)
+        {
+            EXPECT_EQ(fills[i].passiveOid, expectedFills[i].passiveOid);
+            EXPECT_EQ(fills[i].size, expectedFills[i].size);
+            EXPECT_EQ(fills[i].passiveRemaining, expectedFills[i].passiveRemaining);
+        }
+        oids.push_back(oid);
+
+        const BookSnapshot snapshot = this->book.snapshot(3);
+        const BookSnapshot expectedSnapshot = expected.snapshot(3);
+        ASSERT_EQ(snapshot.bids.size(), expectedSnapshot.bids.size());
+        ASSERT_EQ(snapshot.asks.size(), expectedSnapshot.asks.size());
+        for (size_t i = 0; i < snapshot.bids.size(); ++i)
+        {
+            EXPECT_DOUBLE_EQ(snapshot.bids[i].price, expectedSnapshot.bids[i].price);
+            EXPECT_EQ(snapshot.bids[i].size, expectedSnapshot.bids[i].size);
+        }
+        for (size_t i = 0; i < snapshot.asks.size(); ++i)
+        {
+            EXPECT_DOUBLE_EQ(snapshot.asks[i].price, expectedSnapshot.asks[i].price);
+            EXPECT_EQ(snapshot.asks[i].size, expectedSnapshot.asks[i].size);
+        }
+    }
+}
+
+TEST(OrderBookPolicyTest, TickArrayRange)
+{
+    TickArrayChunkedBook book;
+    EXPECT_THROW(book.add(1, "B", 200.01, 1), std::out_of_range);
+    EXPECT_THROW(book.add(2, "B", -0.01, 1), std::out_of_range);
+    EXPECT_TRUE(book.add(3, "B", 200, 1).empty());
+    EXPECT_EQ(book.snapshot(1).bestBid()->price, 200);
+
+    // An aggressive order outside the range throws before it trades, leaving the book as it was
+    EXPECT_TRUE(book.cancel(3));
+    EXPECT_TRUE(book.add(4, "B", 100, 1).empty());
+    EXPECT_TRUE(book.add(5, "A", 150, 5).empty());
+    EXPECT_THROW(book.add(6, "A", -1, 10), std::out_of_range);
+    EXPECT_THROW(book.add(7, "B", 300, 10), std::out_of_range);
+    const BookSnapshot snapshot = book.snapshot(1);
+    EXPECT_EQ(snapshot.bestBid()->price, 100);
+    EXPECT_EQ(snapshot.bestBid()->size, 1);
+    EXPECT_EQ(snapshot.bestAsk()->price, 150);
+    EXPECT_EQ(snapshot.bestAsk()->size, 5);
+    EXPECT_TRUE(book.cancel(4));
+    EXPECT_TRUE(book.cancel(5));
+    EXPECT_FALSE(book.cancel(6));
+}
+
+TEST(OrderBookPolicyTest, TickArraySparseSnapshot)
+{
+    // Deeper than the book, so the walk has to stop at the last live level on each side
+    TickArrayChunkedBook book;
+    EXPECT_TRUE(book.add(1, "B", 100, 1).empty());
+    EXPECT_TRUE(book.add(2, "B", 0.5, 2).empty());
+    EXPECT_TRUE(book.add(3, "A", 150, 3).empty());
+    const BookSnapshot snapshot = book.snapshot(100);
+    ASSERT_EQ(snapshot.bids.size(), 2);
+    EXPECT_EQ(snapshot.bids[1].price, 0.5);
+    EXPECT_EQ(snapshot.bids[1].size, 2);
+    ASSERT_EQ(snapshot.asks.size(), 1);
+    EXPECT_EQ(snapshot.asks[0].size, 3);
+}
+
+TEST(OrderBookPolicyTest, TickPriceTooLarge)
+{
+    TickVectorBook book;
+    EXPECT_TRUE(book.add(1, "B", 1, 10).empty());
+    EXPECT_THROW(book.add(2, "A", -1e300, 10), std::out_of_range);
+    EXPECT_THROW(book.add(3, "B", 1e17, 10), std::out_of_range);
+    EXPECT_EQ(book.snapshot(1).bestBid()->size, 10);
+    EXPECT_EQ(book.snapshot(1).bestAsk(), nullptr);
+}
+
+TEST(OrderBookPolicyTest, TickPriceRounds)
+{
+    TickVectorBook book;
+    book.add(1, "B", 1.004, 1);
+    book.add(2, "B", 0.996, 1);
+    const BookSnapshot snapshot = book.snapshot(2);
+    ASSERT_EQ(snapshot.bids.size(), 1);
+    EXPECT_EQ(snapshot.bestBid()->price, 1);
+    EXPECT_EQ(snapshot.bestBid()->orders, 2);
+}
+
+TEST(OrderBookPolicyTest, CallbackFillSink)
+{
+    std::vector<Fill> received;
+    const auto callback = [&](const Fill& fill) { received.push_back(fill); };
+    using Sink = CallbackFillSink<decltype(callback)>;
+    OrderBook<DoublePrice, ListLevels, MapLevelIndex, HashOrderIndex, Sink> book(std::allocator<Order>(),
+                                                                                   Sink{callback});
+    EXPECT_EQ(book.add(1, "B", 1, 10), 0);
+    EXPECT_EQ(book.add(2, "B", 1, 10), 0);
+    EXPECT_EQ(book.add(3, "A", 1, 15), 2);
+    ASSERT_EQ(received.size(), 2);
+    EXPECT_EQ(received[0].passiveOid, 1);
+    EXPECT_EQ(received[1].passiveOid, 2);
+    EXPECT_EQ(received[1].passiveRemaining, 5);
+}
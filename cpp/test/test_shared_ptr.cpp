@@ -1,3 +1,10 @@
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 #include "lib/SharedPtr.h"
@@ -15,6 +22,56 @@ public:
     int getInt() const { return b; }
 };
 
+// Counts live instances so tests can check exactly when the object is deleted
+class Counted
+{
+public:
+    static inline int alive = 0;
+
+    Counted() { ++alive; }
+
+    ~Counted() { --alive; }
+};
+
+// Counts the allocations it makes, shared by all copies and rebinds
+template <typename T>
+struct CountingAllocator
+{
+    using value_type = T;
+
+    int* allocations;
+
+    explicit CountingAllocator(int* allocations) : allocations(allocations) {}
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>& other) : allocations(other.allocations)
+    {}
+
+    T* allocate(const size_t n)
+    {
+        ++*allocations;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, const size_t n)
+    {
+        --*allocations;
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U>& other) const
+    {
+        return allocations == other.allocations;
+    }
+
+    template <typename U>
+    bool operator!=(const CountingAllocator<U>& other) const
+    {
+        return allocations != other.allocations;
+    }
+};
+
 TEST(SharedPtrTest, DefaultConstruct)
 {
     SharedPtr<int> a;
@@ -60,3 +117,124 @@ TEST(SharedPtrTest, MakeShared)
     EXPECT_EQ(fooPtr->getString(), "a");
     EXPECT_EQ(fooPtr->getInt(), 1);
 }
+
+TEST(SharedPtrTest, UseCount)
+{
+    SharedPtr<int> a;
+    EXPECT_EQ(a.useCount(), 0);
+    SharedPtr<int> b{a};
+    EXPECT_EQ(b.useCount(), 0);
+
+    SharedPtr<int> c{new int{1}};
+    EXPECT_EQ(c.useCount(), 1);
+    {
+        SharedPtr<int> d{c};
+        EXPECT_EQ(c.useCount(), 2);
+        d = d;
+        EXPECT_EQ(c.useCount(), 2);
+    }
+    EXPECT_EQ(c.useCount(), 1);
+}
+
+TEST(SharedPtrTest, Release)
+{
+    {
+        SharedPtr<Counted> a = makeShared<Counted>();
+        SharedPtr<Counted> b = makeShared<Counted>();
+        EXPECT_EQ(Counted::alive, 2);
+        a = std::move(b);
+        EXPECT_EQ(Counted::alive, 1);
+        EXPECT_EQ(b.get(), nullptr);
+        EXPECT_EQ(a.useCount(), 1);
+        SharedPtr<Counted> c;
+        a = c;
+        EXPECT_EQ(Counted::alive, 0);
+    }
+    EXPECT_EQ(Counted::alive, 0);
+}
+
+TEST(SharedPtrTest, AtomicRefCount)
+{
+    SharedPtr<Counted, AtomicRefCount> a = makeShared<Counted, AtomicRefCount>();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back(
+            [copy = a]
+            {
+                for (int i = 0; i < 10000; ++i)
+                {
+                    SharedPtr<Counted, AtomicRefCount> local{copy};
+                    SharedPtr<Counted, AtomicRefCount> moved{std::move(local)};
+                }
+            });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(a.useCount(), 1);
+    EXPECT_EQ(Counted::alive, 1);
+    a = SharedPtr<Counted, AtomicRefCount>();
+    EXPECT_EQ(Counted::alive, 0);
+}
+
+TEST(SharedPtrTest, MakeSharedAlignment)
+{
+    struct alignas(64) Aligned
+    {
+        int value;
+    };
+    SharedPtr<Aligned> a = makeShared<Aligned>(Aligned{7});
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(a.get()) % 64, 0);
+    EXPECT_EQ(a->value, 7);
+}
+
+TEST(SharedPtrTest, MakeSharedThrows)
+{
+    struct Throws
+    {
+        Throws() { throw std::runtime_error("Throws"); }
+    };
+    EXPECT_THROW(makeShared<Throws>(), std::runtime_error);
+}
+
+TEST(SharedPtrTest, CustomDeleter)
+{
+    Counted pool[2];
+    int deleted = 0;
+    {
+        SharedPtr<Counted> a{&pool[0], [&](Counted* p) { deleted += p == &pool[0]; }};
+        SharedPtr<Counted> b{a};
+        EXPECT_EQ(a.useCount(), 2);
+    }
+    EXPECT_EQ(deleted, 1);
+
+    int allocations = 0;
+    {
+        SharedPtr<Counted> a{&pool[1], [&](Counted*) { ++deleted; }, CountingAllocator<Counted>(&allocations)};
+        EXPECT_EQ(allocations, 1);
+    }
+    EXPECT_EQ(allocations, 0);
+    EXPECT_EQ(deleted, 2);
+}
+
+TEST(SharedPtrTest, AllocateShared)
+{
+    int allocations = 0;
+    {
+        SharedPtr<Foo> a = allocateShared<Foo>(CountingAllocator<Foo>(&allocations), "a", 1);
+        EXPECT_EQ(allocations, 1);
+        EXPECT_EQ(a->getString(), "a");
+        SharedPtr<Foo> b{a};
+        EXPECT_EQ(allocations, 1);
+    }
+    EXPECT_EQ(allocations, 0);
+
+    {
+        auto a = allocateShared<Counted, AtomicRefCount>(CountingAllocator<char>(&allocations));
+        EXPECT_EQ(Counted::alive, 1);
+    }
+    EXPECT_EQ(Counted::alive, 0);
+    EXPECT_EQ(allocations, 0);
+}
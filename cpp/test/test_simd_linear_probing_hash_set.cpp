@@ -0,0 +1,97 @@
+#include <random>
+#include <string>
+#include <unordered_set>
+
+#include "gtest/gtest.h"
+
+#include "lib/SimdLinearProbingHashSet.h"
+
+class SimdLinearProbingHashSetTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        EXPECT_TRUE(hs.insert(1));
+        EXPECT_TRUE(hs.contains(1));
+        EXPECT_TRUE(hs.insert(2));
+        EXPECT_TRUE(hs.contains(2));
+        EXPECT_TRUE(hs.insert(3));
+        EXPECT_TRUE(hs.contains(3));
+        EXPECT_FALSE(hs.insert(3));
+        EXPECT_FALSE(hs.contains(4));
+        EXPECT_EQ(hs.size(), 3);
+    }
+
+    SimdLinearProbingHashSet<int> hs{10};
+};
+
+TEST_F(SimdLinearProbingHashSetTest, Insert)
+{
+    EXPECT_EQ(hs.capacity(), 16);
+    EXPECT_TRUE(hs.insert(4));
+    EXPECT_TRUE(hs.contains(4));
+    EXPECT_EQ(hs.size(), 4);
+}
+
+TEST_F(SimdLinearProbingHashSetTest, Remove)
+{
+    EXPECT_FALSE(hs.remove(4));
+    EXPECT_TRUE(hs.remove(1));
+    EXPECT_FALSE(hs.contains(1));
+    EXPECT_TRUE(hs.contains(2));
+    EXPECT_TRUE(hs.remove(2));
+    EXPECT_TRUE(hs.remove(3));
+    EXPECT_EQ(hs.size(), 0);
+    EXPECT_TRUE(hs.insert(1));
+    EXPECT_TRUE(hs.contains(1));
+}
+
+TEST_F(SimdLinearProbingHashSetTest, Resize)
+{
+    hs.resize(100);
+    EXPECT_EQ(hs.capacity(), 128);
+    EXPECT_EQ(hs.size(), 3);
+    EXPECT_TRUE(hs.contains(1));
+    EXPECT_TRUE(hs.contains(2));
+    EXPECT_TRUE(hs.contains(3));
+}
+
+TEST(SimdLinearProbingHashSetRandomTest, MatchesUnorderedSet)
+{
+    SimdLinearProbingHashSet<uint32_t> hs{16, 0.95f};
+    std::unordered_set<uint32_t> expected;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> keys(0, 5000);
+    for (int i = 0; i < 100000; ++i)
+    {
+        const uint32_t key = keys(rng);
+        switch (rng() % 3)
+        {
+            case 0: EXPECT_EQ(hs.insert(key), expected.insert(key).second); break;
+            case 1: EXPECT_EQ(hs.remove(key), expected.erase(key) == 1); break;
+            default: EXPECT_EQ(hs.contains(key), expected.count(key) == 1); break;
+        }
+        ASSERT_EQ(hs.size(), expected.size());
+    }
+    EXPECT_LE(hs.loadFactor(), hs.maxLoadFactor());
+    for (uint32_t key = 0; key <= 5000; ++key)
+    {
+        EXPECT_EQ(hs.contains(key), expected.count(key) == 1);
+    }
+}
+
+TEST(SimdLinearProbingHashSetStringTest, NonTrivialType)
+{
+    SimdLinearProbingHashSet<std::string> hs;
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_TRUE(hs.insert("order-" + std::to_string(i)));
+    }
+    for (int i = 0; i < 100; i += 2)
+    {
+        EXPECT_TRUE(hs.remove("order-" + std::to_string(i)));
+    }
+    EXPECT_EQ(hs.size(), 50);
+    EXPECT_FALSE(hs.contains("order-0"));
+    EXPECT_TRUE(hs.contains("order-1"));
+}
@@ -0,0 +1,112 @@
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "lib/SPMCBroadcastRing.h"
+
+TEST(SPMCBroadcastRingTest, EveryConsumerSeesEveryElement)
+{
+    SPMCBroadcastRing<int> ring(10, 3);
+    EXPECT_EQ(ring.capacity(), 16);
+    EXPECT_EQ(ring.consumers(), 3);
+    for (int i = 0; i < 10; ++i)
+    {
+        ring.push(i);
+    }
+
+    for (size_t c = 0; c < ring.consumers(); ++c)
+    {
+        EXPECT_EQ(ring.size(c), 10);
+        for (int i = 0; i < 10; ++i)
+        {
+            const int* j = ring.front(c);
+            ASSERT_NE(j, nullptr);
+            EXPECT_EQ(*j, i);
+            EXPECT_EQ(ring.readSequence(c), i);
+            ring.pop(c);
+        }
+        EXPECT_EQ(ring.front(c), nullptr);
+        EXPECT_TRUE(ring.empty(c));
+    }
+}
+
+TEST(SPMCBroadcastRingTest, ProducerGatesOnSlowestConsumer)
+{
+    SPMCBroadcastRing<int> ring(2, 2);
+    EXPECT_TRUE(ring.try_push(1));
+    EXPECT_TRUE(ring.try_push(2));
+    EXPECT_FALSE(ring.try_push(3));
+
+    // Only the fast consumer moves, the ring stays full
+    ring.front(0);
+    ring.pop(0);
+    EXPECT_FALSE(ring.try_push(3));
+
+    ring.front(1);
+    ring.pop(1);
+    EXPECT_TRUE(ring.try_push(3));
+    EXPECT_EQ(ring.size(0), 2);
+    EXPECT_EQ(ring.size(1), 2);
+}
+
+TEST(SPMCBroadcastRingTest, DestroysElements)
+{
+    auto value = std::make_shared<int>(1);
+    {
+        SPMCBroadcastRing<std::shared_ptr<int>> ring(2, 1);
+        for (int i = 0; i < 5; ++i)
+        {
+            ring.push(value);
+            ring.front(0);
+            ring.pop(0);
+        }
+        ring.push(value);
+        EXPECT_EQ(value.use_count(), 3);
+    }
+    EXPECT_EQ(value.use_count(), 1);
+}
+
+TEST(SPMCBroadcastRingTest, ConcurrentConsumers)
+{
+    constexpr int count = 10000;
+    constexpr size_t numConsumers = 3;
+    SPMCBroadcastRing<int> ring(64, numConsumers);
+
+    std::vector<long long> sums(numConsumers, 0);
+    std::vector<std::thread> consumers;
+    for (size_t c = 0; c < numConsumers; ++c)
+    {
+        consumers.emplace_back(
+            [&, c]
+            {
+                for (int i = 0; i < count; ++i)
+                {
+                    const int* j;
+                    while (!(j = ring.front(c)))
+                    {
+                        std::this_thread::yield();
+                    }
+                    EXPECT_EQ(*j, i);
+                    sums[c] += *j;
+                    ring.pop(c);
+                }
+            });
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        while (!ring.try_push(i))
+        {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& consumer : consumers)
+    {
+        consumer.join();
+    }
+    for (const long long sum : sums)
+    {
+        EXPECT_EQ(sum, static_cast<long long>(count) * (count - 1) / 2);
+    }
+}
@@ -1,3 +1,5 @@
+#include <thread>
+
 #include "gtest/gtest.h"
 
 #include "lib/SPSCQueue.h"
@@ -17,3 +19,134 @@ TEST(SPSCQueueTest, PushPop)
         q.pop();
     }
 }
+
+TEST(SPSCQueueTest, TryPushFull)
+{
+    SPSCQueue<int> q(2);
+    EXPECT_EQ(q.capacity(), 2);
+    EXPECT_TRUE(q.try_push(1));
+    EXPECT_TRUE(q.try_push(2));
+    EXPECT_FALSE(q.try_push(3));
+    EXPECT_EQ(q.size(), 2);
+}
+
+TEST(SPSCQueueTest, PowerOfTwoCapacity)
+{
+    PowerOfTwoSPSCQueue<int> q(10);
+    EXPECT_EQ(q.capacity(), 16);
+    for (int i = 0; i < 16; ++i)
+    {
+        EXPECT_TRUE(q.try_push(i));
+    }
+    EXPECT_FALSE(q.try_push(16));
+    EXPECT_EQ(q.size(), 16);
+}
+
+TEST(SPSCQueueTest, PowerOfTwoWrapAround)
+{
+    PowerOfTwoSPSCQueue<int> q(4);
+    for (int i = 0; i < 100; ++i)
+    {
+        q.push(i);
+        q.push(i + 1);
+        EXPECT_EQ(q.size(), 2);
+        EXPECT_EQ(*q.front(), i);
+        q.pop();
+        EXPECT_EQ(*q.front(), i + 1);
+        q.pop();
+        EXPECT_TRUE(q.empty());
+    }
+    EXPECT_EQ(q.writeSequence(), 200);
+    EXPECT_EQ(q.readSequence(), 200);
+}
+
+TEST(SPSCQueueTest, PowerOfTwoSequence)
+{
+    PowerOfTwoSPSCQueue<int> q(8);
+    for (int i = 0; i < 5; ++i)
+    {
+        q.push(i);
+    }
+    for (int i = 0; i < 2; ++i)
+    {
+        EXPECT_EQ(q.readSequence(), i);
+        EXPECT_EQ(*q.front(), i);
+        q.pop();
+    }
+    EXPECT_EQ(q.readSequence(), 2);
+    EXPECT_EQ(q.writeSequence(), 5);
+    EXPECT_EQ(*q.front(), 2);
+}
+
+TEST(SPSCQueueTest, Telemetry)
+{
+    SPSCQueue<int, std::allocator<int>, false, true> q(2);
+    EXPECT_EQ(q.front(), nullptr);
+    EXPECT_TRUE(q.try_push(1));
+    EXPECT_TRUE(q.try_push(2));
+    EXPECT_FALSE(q.try_push(3));
+    for (int i = 1; i <= 2; ++i)
+    {
+        EXPECT_EQ(*q.front(), i);
+        q.pop();
+    }
+    EXPECT_EQ(q.front(), nullptr);
+
+    const SPSCQueueTelemetry telemetry = q.telemetry();
+    EXPECT_EQ(telemetry.fullStalls, 0);
+    EXPECT_EQ(telemetry.fullSpins, 0);
+    EXPECT_EQ(telemetry.tryEmplaceFailures, 1);
+    EXPECT_EQ(telemetry.emptyPolls, 2);
+    EXPECT_EQ(telemetry.highWaterMark, 2);
+}
+
+TEST(SPSCQueueTest, TelemetryFullStall)
+{
+    SPSCQueue<int, std::allocator<int>, true, true> q(1);
+    q.push(0);
+    std::thread consumer(
+        [&]
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            for (int i = 0; i < 2; ++i)
+            {
+                while (!q.front())
+                {
+                }
+                q.pop();
+            }
+        });
+    q.push(1);
+    consumer.join();
+
+    const SPSCQueueTelemetry telemetry = q.telemetry();
+    EXPECT_EQ(telemetry.fullStalls, 1);
+    EXPECT_GE(telemetry.fullSpins, 1);
+    EXPECT_EQ(telemetry.highWaterMark, 1);
+}
+
+TEST(SPSCQueueTest, TelemetrySampledOccupancy)
+{
+    // The cached read index goes stale while the consumer keeps up, the sampled occupancy must not
+    SPSCQueue<int, std::allocator<int>, true, true> q(16);
+    for (int i = 0; i < 1000; ++i)
+    {
+        q.push(i);
+        EXPECT_EQ(*q.front(), i);
+        q.pop();
+    }
+    EXPECT_EQ(q.telemetry().highWaterMark, 1);
+
+    for (int i = 0; i < 16; ++i)
+    {
+        EXPECT_TRUE(q.try_push(i));
+    }
+    EXPECT_FALSE(q.try_push(16));
+    EXPECT_EQ(q.telemetry().highWaterMark, 16);
+}
+
+TEST(SPSCQueueTest, TelemetryLayout)
+{
+    EXPECT_EQ(sizeof(SPSCQueue<int>), sizeof(SPSCQueue<int, std::allocator<int>, false, false>));
+    EXPECT_EQ(sizeof(SPSCQueue<int>), sizeof(SPSCQueue<int, std::allocator<int>, false, true>));
+}
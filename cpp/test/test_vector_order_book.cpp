@@ -112,28 +112,29 @@ TEST_F(VectorOrderBookTest, MatchBid)
     const auto& bids = book.getBids();
     EXPECT_EQ(bids.size(), 3);
 
-    const auto& orders = book.add(7, "A", 2, 20);
-    EXPECT_EQ(orders.size(), 4);
-
-    const Order& o0 = orders.at(0);
-    EXPECT_EQ(o0.oid, 7);
-    EXPECT_EQ(o0.price, 3);
-    EXPECT_EQ(o0.size, 13);
-
-    const Order& o1 = orders.at(1);
-    EXPECT_EQ(o1.oid, 3);
-    EXPECT_EQ(o1.price, 3);
-    EXPECT_EQ(o1.size, 13);
-
-    const Order& o2 = orders.at(2);
-    EXPECT_EQ(o2.oid, 7);
-    EXPECT_EQ(o2.price, 2);
-    EXPECT_EQ(o2.size, 7);
-
-    const Order& o3 = orders.at(3);
-    EXPECT_EQ(o3.oid, 2);
-    EXPECT_EQ(o3.price, 2);
-    EXPECT_EQ(o3.size, 7);
+    const auto& fills = book.add(7, "A", 2, 20);
+    EXPECT_EQ(fills.size(), 2);
+
+    const Fill& f0 = fills.at(0);
+    EXPECT_EQ(f0.aggressorOid, 7);
+    EXPECT_EQ(f0.passiveOid, 3);
+    EXPECT_EQ(f0.price, 3);
+    EXPECT_EQ(f0.size, 13);
+    EXPECT_EQ(f0.passiveRemaining, 0);
+    EXPECT_TRUE(f0.passiveFilled);
+
+    const Fill& f1 = fills.at(1);
+    EXPECT_EQ(f1.aggressorOid, 7);
+    EXPECT_EQ(f1.passiveOid, 2);
+    EXPECT_EQ(f1.price, 2);
+    EXPECT_EQ(f1.size, 7);
+    EXPECT_EQ(f1.passiveRemaining, 5);
+    EXPECT_FALSE(f1.passiveFilled);
+
+    // The filled order is gone, the partially filled one can still be cancelled
+    EXPECT_EQ(bids.size(), 2);
+    EXPECT_FALSE(book.cancel(3));
+    EXPECT_TRUE(book.cancel(2));
 }
 
 TEST_F(VectorOrderBookTest, MatchAsk)
@@ -141,26 +142,65 @@ TEST_F(VectorOrderBookTest, MatchAsk)
     const auto& asks = book.getAsks();
     EXPECT_EQ(asks.size(), 3);
 
-    const auto& orders = book.add(7, "B", 5, 20);
-    EXPECT_EQ(orders.size(), 4);
-
-    const Order& o0 = orders.at(0);
-    EXPECT_EQ(o0.oid, 7);
-    EXPECT_EQ(o0.price, 4);
-    EXPECT_EQ(o0.size, 14);
-
-    const Order& o1 = orders.at(1);
-    EXPECT_EQ(o1.oid, 4);
-    EXPECT_EQ(o1.price, 4);
-    EXPECT_EQ(o1.size, 14);
-
-    const Order& o2 = orders.at(2);
-    EXPECT_EQ(o2.oid, 7);
-    EXPECT_EQ(o2.price, 5);
-    EXPECT_EQ(o2.size, 6);
-
-    const Order& o3 = orders.at(3);
-    EXPECT_EQ(o3.oid, 5);
-    EXPECT_EQ(o3.price, 5);
-    EXPECT_EQ(o3.size, 6);
-}
\ No newline at end of file
+    const auto& fills = book.add(7, "B", 5, 20);
+    EXPECT_EQ(fills.size(), 2);
+
+    const Fill& f0 = fills.at(0);
+    EXPECT_EQ(f0.aggressorOid, 7);
+    EXPECT_EQ(f0.passiveOid, 4);
+    EXPECT_EQ(f0.price, 4);
+    EXPECT_EQ(f0.size, 14);
+    EXPECT_EQ(f0.passiveRemaining, 0);
+    EXPECT_TRUE(f0.passiveFilled);
+
+    const Fill& f1 = fills.at(1);
+    EXPECT_EQ(f1.aggressorOid, 7);
+    EXPECT_EQ(f1.passiveOid, 5);
+    EXPECT_EQ(f1.price, 5);
+    EXPECT_EQ(f1.size, 6);
+    EXPECT_EQ(f1.passiveRemaining, 9);
+    EXPECT_FALSE(f1.passiveFilled);
+
+    EXPECT_EQ(asks.size(), 2);
+    EXPECT_FALSE(book.cancel(4));
+    EXPECT_TRUE(book.cancel(5));
+}
+TEST_F(VectorOrderBookTest, Snapshot)
+{
+    book.add(7, "B", 3, 7);
+    const BookSnapshot snapshot = book.snapshot(2);
+    ASSERT_EQ(snapshot.bids.size(), 2);
+    EXPECT_EQ(snapshot.bestBid()->price, 3);
+    EXPECT_EQ(snapshot.bestBid()->size, 20);
+    EXPECT_EQ(snapshot.bestBid()->orders, 2);
+    EXPECT_EQ(snapshot.bids[1].price, 2);
+    ASSERT_EQ(snapshot.asks.size(), 2);
+    EXPECT_EQ(snapshot.bestAsk()->price, 4);
+    EXPECT_EQ(snapshot.bestAsk()->size, 14);
+    EXPECT_EQ(snapshot.asks[1].price, 5);
+
+    EXPECT_EQ(book.snapshot(10).asks.size(), 3);
+    EXPECT_EQ(book.snapshot(0).bestBid(), nullptr);
+}
+
+TEST_F(VectorOrderBookTest, CancelAfterLevelChanges)
+{
+    // Enough orders at one price to reallocate the level, then fill the front of it
+    for (OrderIdT oid = 10; oid < 110; ++oid)
+    {
+        EXPECT_TRUE(book.add(oid, "B", 3, 1).empty());
+    }
+    // Trades with oid 3 for 13 then oids 10 to 16
+    EXPECT_EQ(book.add(200, "A", 3, 20).size(), 8);
+
+    const auto& level = *book.getBids().rbegin();
+    EXPECT_EQ(level.size(), 93);
+    EXPECT_EQ(level.getOids().front(), 17);
+    EXPECT_EQ(level.getSizes().front(), 1);
+    EXPECT_EQ(level.totalSize(), 93);
+
+    EXPECT_FALSE(book.cancel(10));
+    EXPECT_TRUE(book.cancel(50));
+    EXPECT_TRUE(book.cancel(109));
+    EXPECT_EQ(level.size(), 91);
+}